@@ -81,6 +81,36 @@
 #define SCTLR_AFE	(1 << 29)
 #define SCTLR_TE	(1 << 30)
 
+#define ACTLR_SMP	(1 << 6)
+
+#define CTR_DMINLINE_SHIFT	16
+#define CTR_DMINLINE_MASK	0xf
+
+#define CLIDR_LOUIS_SHIFT	21
+#define CLIDR_LOC_SHIFT		24
+#define CLIDR_LOC_MASK		0x7
+#define CLIDR_CTYPE_MASK	0x7
+#define CLIDR_CTYPE_DCACHE	2
+
+#define CCSIDR_LINESIZE_MASK		0x7
+#define CCSIDR_ASSOC_SHIFT		3
+#define CCSIDR_ASSOC_MASK		0x3ff
+#define CCSIDR_NUMSETS_SHIFT		13
+#define CCSIDR_NUMSETS_MASK		0x7fff
+
+#define CPACR_CP10_CP11	(0xf << 20)
+
+#define FPEXC_EN	(1 << 30)
+
+#define PMCR_E		(1 << 0)
+#define PMCR_P		(1 << 1)
+#define PMCR_C		(1 << 2)
+#define PMCR_D		(1 << 3)
+#define PMCR_N_SHIFT	11
+#define PMCR_N_MASK	0x1f
+
+#define PMCNTENSET_C	(1 << 31)
+
 #ifndef ASM
 static inline uint32_t read_mpidr(void)
 {
@@ -111,6 +141,71 @@ static inline void write_sctlr(uint32_t sctlr)
 	);
 }
 
+static inline uint32_t read_actlr(void)
+{
+	uint32_t actlr;
+
+	asm ("mrc	p15, 0, %[actlr], c1, c0, 1"
+			: [actlr] "=r" (actlr)
+	);
+
+	return actlr;
+}
+
+static inline void write_actlr(uint32_t actlr)
+{
+	asm ("mcr	p15, 0, %[actlr], c1, c0, 1"
+			: : [actlr] "r" (actlr)
+	);
+}
+
+static inline uint32_t read_ctr(void)
+{
+	uint32_t ctr;
+
+	asm ("mrc	p15, 0, %[ctr], c0, c0, 1"
+			: [ctr] "=r" (ctr)
+	);
+
+	return ctr;
+}
+
+static inline uint32_t read_clidr(void)
+{
+	uint32_t clidr;
+
+	asm ("mrc	p15, 1, %[clidr], c0, c0, 1"
+			: [clidr] "=r" (clidr)
+	);
+
+	return clidr;
+}
+
+static inline uint32_t read_ccsidr(void)
+{
+	uint32_t ccsidr;
+
+	asm volatile ("mrc	p15, 1, %[ccsidr], c0, c0, 0"
+			: [ccsidr] "=r" (ccsidr)
+	);
+
+	return ccsidr;
+}
+
+static inline void write_csselr(uint32_t csselr)
+{
+	asm ("mcr	p15, 2, %[csselr], c0, c0, 0"
+			: : [csselr] "r" (csselr)
+	);
+}
+
+static inline void write_ttbcr(uint32_t ttbcr)
+{
+	asm ("mcr	p15, 0, %[ttbcr], c2, c0, 2"
+			: : [ttbcr] "r" (ttbcr)
+	);
+}
+
 static inline void write_ttbr0(uint32_t ttbr0)
 {
 	asm ("mcr	p15, 0, %[ttbr0], c2, c0, 0"
@@ -135,12 +230,163 @@ static inline void dsb(void)
 	asm ("dsb");
 }
 
+static inline void dmb(void)
+{
+	asm volatile ("dmb" : : : "memory");
+}
+
+static inline void wfe(void)
+{
+	asm volatile ("wfe" : : : "memory");
+}
+
+static inline void sev(void)
+{
+	asm volatile ("sev" : : : "memory");
+}
+
+static inline void write_tlbiall(void)
+{
+	/* Invalidate entire unified TLB, r0 ignored */
+	asm ("mcr	p15, 0, r0, c8, c7, 0");
+}
+
 static inline void write_tlbiallis(void)
 {
 	/* Invalidate entire unified TLB Inner Shareable, r0 ignored */
 	asm ("mcr	p15, 0, r0, c8, c3, 0");
 }
 
+static inline void write_dcisw(uint32_t sw)
+{
+	asm ("mcr	p15, 0, %[sw], c7, c6, 2"
+			: : [sw] "r" (sw) : "memory"
+	);
+}
+
+static inline void write_dcimvac(uint32_t va)
+{
+	asm ("mcr	p15, 0, %[va], c7, c6, 1"
+			: : [va] "r" (va) : "memory"
+	);
+}
+
+static inline void write_dccmvac(uint32_t va)
+{
+	asm ("mcr	p15, 0, %[va], c7, c10, 1"
+			: : [va] "r" (va) : "memory"
+	);
+}
+
+static inline void write_dccimvac(uint32_t va)
+{
+	asm ("mcr	p15, 0, %[va], c7, c14, 1"
+			: : [va] "r" (va) : "memory"
+	);
+}
+
+static inline void write_iciallu(void)
+{
+	/* Invalidate all instruction caches to PoU, r0 ignored */
+	asm ("mcr	p15, 0, r0, c7, c5, 0");
+}
+
+static inline void write_bpiall(void)
+{
+	/* Invalidate entire branch predictor array, r0 ignored */
+	asm ("mcr	p15, 0, r0, c7, c5, 6");
+}
+
+static inline uint32_t read_pmccntr(void)
+{
+	uint32_t pmccntr;
+
+	asm volatile ("mrc	p15, 0, %[pmccntr], c9, c13, 0"
+			: [pmccntr] "=r" (pmccntr)
+	);
+
+	return pmccntr;
+}
+
+static inline uint32_t read_pmcr(void)
+{
+	uint32_t pmcr;
+
+	asm ("mrc	p15, 0, %[pmcr], c9, c12, 0"
+			: [pmcr] "=r" (pmcr)
+	);
+
+	return pmcr;
+}
+
+static inline void write_pmcr(uint32_t pmcr)
+{
+	asm volatile ("mcr	p15, 0, %[pmcr], c9, c12, 0"
+			: : [pmcr] "r" (pmcr)
+	);
+}
+
+static inline void write_pmcntenset(uint32_t mask)
+{
+	asm volatile ("mcr	p15, 0, %[mask], c9, c12, 1"
+			: : [mask] "r" (mask)
+	);
+}
+
+static inline void write_pmselr(uint32_t sel)
+{
+	asm volatile ("mcr	p15, 0, %[sel], c9, c12, 5"
+			: : [sel] "r" (sel)
+	);
+}
+
+static inline void write_pmxevtyper(uint32_t type)
+{
+	asm volatile ("mcr	p15, 0, %[type], c9, c13, 1"
+			: : [type] "r" (type)
+	);
+}
+
+static inline void write_pmxevcntr(uint32_t cnt)
+{
+	asm volatile ("mcr	p15, 0, %[cnt], c9, c13, 2"
+			: : [cnt] "r" (cnt)
+	);
+}
+
+static inline uint32_t read_pmxevcntr(void)
+{
+	uint32_t cnt;
+
+	asm volatile ("mrc	p15, 0, %[cnt], c9, c13, 2"
+			: [cnt] "=r" (cnt)
+	);
+
+	return cnt;
+}
+
+static inline uint32_t read_cntfrq(void)
+{
+	uint32_t frq;
+
+	asm ("mrc	p15, 0, %[frq], c14, c0, 0"
+			: [frq] "=r" (frq)
+	);
+
+	return frq;
+}
+
+static inline uint64_t read_cntpct(void)
+{
+	uint64_t val;
+
+	asm volatile ("mrrc	p15, 0, %Q[val], %R[val], c14"
+			: [val] "=r" (val)
+	);
+
+	return val;
+}
+
 static inline uint32_t read_cpsr(void)
 {
 	uint32_t cpsr;
@@ -3,6 +3,22 @@ include bios/conf.mk
 cppflags += -DPLATFORM_FLAVOR=PLATFORM_FLAVOR_ID_$(PLATFORM_FLAVOR)
 cppflags += -Iinclude
 cppflags += -DCOMMAND_LINE="\"$(BIOS_COMMAND_LINE)\""
+ifeq ($(PREFER_SIZE_OVER_SPEED),y)
+cppflags += -DPREFER_SIZE_OVER_SPEED
+endif
+ifeq ($(WITH_NEON),y)
+cppflags += -DWITH_NEON
+endif
+ifneq ($(filter-out carve reserved-memory memreserve,$(BIOS_TZ_MEM_DT)),)
+$(error Unknown BIOS_TZ_MEM_DT $(BIOS_TZ_MEM_DT))
+endif
+ifneq ($(filter reserved-memory,$(BIOS_TZ_MEM_DT)),)
+cppflags += -DTZ_MEM_DT_RESERVED_MEMORY
+endif
+ifneq ($(filter memreserve,$(BIOS_TZ_MEM_DT)),)
+cppflags += -DTZ_MEM_DT_MEMRESERVE
+endif
+cppflags += -DTZ_SHM_SIZE=$(BIOS_TZ_SHM_SIZE)
 
 #
 # Do libraries
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arm32.h>
+#include <string.h>
+#include "boot_info.h"
+
+/* Cleaned with the rest of the BIOS RAM by disable_mmu in entry.S */
+static struct boot_info boot_info;
+
+void boot_info_init(void)
+{
+	boot_info.magic = BOOT_INFO_MAGIC;
+	boot_info.version = BOOT_INFO_VERSION;
+	boot_info.size = sizeof(boot_info);
+	boot_info.timer_freq = read_cntfrq();
+	boot_info.time_bios_start = read_cntpct();
+}
+
+void boot_info_set_image_hash(enum boot_info_image image,
+			      const uint8_t hash[BOOT_INFO_HASH_SIZE])
+{
+	if (image >= BOOT_INFO_NUM_IMAGES)
+		return;
+	memcpy(boot_info.image_hash[image], hash, BOOT_INFO_HASH_SIZE);
+	boot_info.image_hash_valid |= 1 << image;
+}
+
+static bool set_ranges(struct boot_info_range *ranges, size_t max,
+		       uint32_t *num, const struct interval_set *set)
+{
+	size_t n;
+
+	if (set->num > max)
+		return false;
+	for (n = 0; n < set->num; n++) {
+		ranges[n].start = set->ivs[n].start;
+		ranges[n].size = set->ivs[n].end - set->ivs[n].start;
+	}
+	*num = set->num;
+	return true;
+}
+
+bool boot_info_set_mem(const struct interval_set *secure,
+		       const struct interval_set *nsec, uint64_t shm_start,
+		       uint64_t shm_size)
+{
+	boot_info.shm.start = shm_start;
+	boot_info.shm.size = shm_size;
+	return set_ranges(boot_info.secure, BOOT_INFO_MAX_SECURE,
+			  &boot_info.num_secure, secure) &&
+	       set_ranges(boot_info.nsec, BOOT_INFO_MAX_NSEC,
+			  &boot_info.num_nsec, nsec);
+}
+
+void boot_info_set_images_loaded(uint64_t uart_base, uint64_t fdt)
+{
+	boot_info.uart_base = uart_base;
+	boot_info.fdt = fdt;
+	boot_info.time_images_loaded = read_cntpct();
+}
+
+uint32_t boot_info_finish(uint32_t num_cpus)
+{
+	boot_info.num_cpus = num_cpus;
+	boot_info.time_secure_entry = read_cntpct();
+	return (uint32_t)&boot_info;
+}
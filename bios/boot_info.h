@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BOOT_INFO_H
+#define BOOT_INFO_H
+
+#include <interval_set.h>
+#include <types_ext.h>
+
+/*
+ * Boot information handed to the secure world, its address is in r5 at
+ * entry. It's laid out with fixed size fields only so the secure world
+ * can read it with its own copy of this layout. A newer version only
+ * appends fields, size tells how much of it the BIOS filled in.
+ *
+ * The block is in the RAM of the BIOS, which isn't reserved from the
+ * normal world: the kernel may run over it. It's only valid until the
+ * secure world returns to the normal world for the first time, the
+ * secure world has to copy what it needs to keep before that.
+ */
+#define BOOT_INFO_MAGIC		0x4f464e49	/* "INFO" */
+#define BOOT_INFO_VERSION	1
+
+#define BOOT_INFO_MAX_SECURE	4
+#define BOOT_INFO_MAX_NSEC	16
+#define BOOT_INFO_HASH_SIZE	32
+
+/* Images with a SHA-256 digest, in the order of the image manifest */
+enum boot_info_image {
+	BOOT_INFO_IMAGE_SECURE,
+	BOOT_INFO_IMAGE_KERNEL,
+	BOOT_INFO_IMAGE_ROOTFS,
+	BOOT_INFO_NUM_IMAGES
+};
+
+struct boot_info_range {
+	uint64_t start;
+	uint64_t size;
+};
+
+struct boot_info {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t num_cpus;
+
+	/* Secure console, the normal world console if it's shared */
+	uint64_t uart_base;
+	/* DTB passed to the kernel */
+	uint64_t fdt;
+
+	/* Secure carve-outs and the memory left to the normal world */
+	uint32_t num_secure;
+	uint32_t num_nsec;
+	struct boot_info_range secure[BOOT_INFO_MAX_SECURE];
+	struct boot_info_range nsec[BOOT_INFO_MAX_NSEC];
+	/* Static shared memory, size 0 if none */
+	struct boot_info_range shm;
+
+	/* Bit n set if image_hash[n] was verified while the image loaded */
+	uint32_t image_hash_valid;
+	uint32_t pad;
+	uint8_t image_hash[BOOT_INFO_NUM_IMAGES][BOOT_INFO_HASH_SIZE];
+
+	/*
+	 * Generic timer counts when the BIOS started loading images, when
+	 * they were all in place and when the secure world was entered.
+	 */
+	uint64_t timer_freq;
+	uint64_t time_bios_start;
+	uint64_t time_images_loaded;
+	uint64_t time_secure_entry;
+};
+
+/* Starts filling in the boot information, called first thing at boot */
+void boot_info_init(void);
+
+void boot_info_set_image_hash(enum boot_info_image image,
+			      const uint8_t hash[BOOT_INFO_HASH_SIZE]);
+
+/* Sets the memory ranges, false if they don't fit */
+bool boot_info_set_mem(const struct interval_set *secure,
+		       const struct interval_set *nsec, uint64_t shm_start,
+		       uint64_t shm_size);
+
+/* Sets the rest once the images are in place */
+void boot_info_set_images_loaded(uint64_t uart_base, uint64_t fdt);
+
+/* Completes the boot information and returns its address */
+uint32_t boot_info_finish(uint32_t num_cpus);
+
+#endif /*BOOT_INFO_H*/
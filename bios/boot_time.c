@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arm32.h>
+#include <libfdt.h>
+#include <string.h>
+#include "boot_time.h"
+
+static struct boot_phase phases[BOOT_TIME_MAX_PHASES];
+static size_t num_phases;
+
+int boot_phase_begin(const char *name)
+{
+	uint64_t t = read_cntpct();
+
+	if (num_phases >= BOOT_TIME_MAX_PHASES)
+		return -1;
+
+	phases[num_phases].name = name;
+	phases[num_phases].start = t;
+	phases[num_phases].end = t;
+	pmu_read(&phases[num_phases].pmu);
+	return num_phases++;
+}
+
+void boot_phase_end(int id)
+{
+	struct pmu_counts counts;
+	uint64_t t;
+
+	pmu_read(&counts);
+	t = read_cntpct();
+
+	if (id < 0 || (size_t)id >= num_phases)
+		return;
+	phases[id].end = t;
+	pmu_diff(&phases[id].pmu, &phases[id].pmu, &counts);
+}
+
+void boot_phase_restart(int id)
+{
+	if (id < 0 || (size_t)id >= num_phases)
+		return;
+	phases[id].start = read_cntpct();
+	phases[id].end = phases[id].start;
+	pmu_read(&phases[id].pmu);
+}
+
+size_t boot_phase_count(void)
+{
+	return num_phases;
+}
+
+const struct boot_phase *boot_phase_get(size_t n)
+{
+	if (n >= num_phases)
+		return NULL;
+	return phases + n;
+}
+
+uint32_t boot_time_freq(void)
+{
+	return read_cntfrq();
+}
+
+static size_t names_size(void)
+{
+	size_t names_len = 0;
+	size_t n;
+
+	for (n = 0; n < num_phases; n++)
+		names_len += strlen(phases[n].name) + 1;
+	return names_len;
+}
+
+/* Fills in the values of "bios,boot-phases" and "bios,boot-times" */
+static void fill_phases(char *names, uint8_t *t)
+{
+	fdt64_t times[2];
+	size_t n;
+
+	for (n = 0; n < num_phases; n++) {
+		size_t l = strlen(phases[n].name) + 1;
+
+		memcpy(names, phases[n].name, l);
+		names += l;
+
+		times[0] = cpu_to_fdt64(phases[n].start);
+		times[1] = cpu_to_fdt64(phases[n].end);
+		memcpy(t + n * sizeof(times), times, sizeof(times));
+	}
+}
+
+int boot_time_add_fdt(struct fdt_live_tree *tree, struct fdt_live_node *node)
+{
+	char *names;
+	void *p;
+	int r;
+
+	r = fdt_live_setprop_u32(tree, node, "bios,timer-frequency",
+				 boot_time_freq());
+	if (r < 0)
+		return r;
+
+	r = fdt_live_setprop_placeholder(tree, node, "bios,boot-phases",
+					 names_size(), &p);
+	if (r < 0)
+		return r;
+	names = p;
+
+	r = fdt_live_setprop_placeholder(tree, node, "bios,boot-times",
+					 num_phases * 2 * sizeof(fdt64_t), &p);
+	if (r < 0)
+		return r;
+
+	fill_phases(names, p);
+	return 0;
+}
+
+int boot_time_add_fdt_sw(void *fdt)
+{
+	char *names;
+	void *p;
+	int r;
+
+	r = fdt_property_u32(fdt, "bios,timer-frequency", boot_time_freq());
+	if (r < 0)
+		return r;
+
+	r = fdt_property_placeholder(fdt, "bios,boot-phases", names_size(),
+				     &p);
+	if (r < 0)
+		return r;
+	names = p;
+
+	r = fdt_property_placeholder(fdt, "bios,boot-times",
+				     num_phases * 2 * sizeof(fdt64_t), &p);
+	if (r < 0)
+		return r;
+
+	fill_phases(names, p);
+	return 0;
+}
+
+int boot_time_update_fdt(void *fdt)
+{
+	fdt64_t times[BOOT_TIME_MAX_PHASES][2];
+	const void *prop;
+	size_t n;
+	int offs;
+	int len;
+
+	/*
+	 * Looked up again as the DTB may have been rewritten since it was
+	 * handed to the secure world
+	 */
+	offs = fdt_path_offset(fdt, "/chosen");
+	if (offs < 0)
+		return offs;
+	prop = fdt_getprop(fdt, offs, "bios,boot-times", &len);
+	if (!prop)
+		return len;
+	if ((size_t)len > sizeof(times) || len % sizeof(times[0]))
+		return -FDT_ERR_BADVALUE;
+
+	/* Phases begun after boot_time_add_fdt() have no room in the DTB */
+	for (n = 0; n < len / sizeof(times[0]); n++) {
+		times[n][0] = cpu_to_fdt64(phases[n].start);
+		times[n][1] = cpu_to_fdt64(phases[n].end);
+	}
+	return fdt_setprop_inplace(fdt, offs, "bios,boot-times", times, len);
+}
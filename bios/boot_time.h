@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef BOOT_TIME_H
+#define BOOT_TIME_H
+
+#include <libfdt.h>
+#include <types_ext.h>
+#include "pmu.h"
+
+#define BOOT_TIME_MAX_PHASES	16
+
+/*
+ * Start and end of a boot phase in generic timer ticks, and the PMU
+ * counts at the start, replaced by the counts over the phase at the end.
+ */
+struct boot_phase {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+	struct pmu_counts pmu;
+};
+
+/*
+ * Starts timing a named boot phase and returns an id to end it with, the
+ * phase isn't recorded if the table is full. The name must stay valid
+ * until the phases are added to the DTB.
+ */
+int boot_phase_begin(const char *name);
+void boot_phase_end(int id);
+
+/*
+ * Starts a phase begun earlier over again, for phases added to the DTB
+ * before they actually start.
+ */
+void boot_phase_restart(int id);
+
+size_t boot_phase_count(void);
+const struct boot_phase *boot_phase_get(size_t n);
+
+/* Generic timer frequency in Hz, 0 if not configured */
+uint32_t boot_time_freq(void);
+
+/*
+ * Adds the recorded phases to a node of the live tree as
+ * "bios,boot-phases", a string list of the names, and "bios,boot-times",
+ * a start and end 64-bit tick count for each name.
+ * "bios,timer-frequency" is the tick frequency in Hz. Returns a libfdt
+ * error code.
+ */
+int boot_time_add_fdt(struct fdt_live_tree *tree, struct fdt_live_node *node);
+
+/* As boot_time_add_fdt(), to the node being written with fdt_sw */
+int boot_time_add_fdt_sw(void *fdt);
+
+/*
+ * Updates "bios,boot-times" in /chosen in place with the phases recorded
+ * since, without changing its size. Returns a libfdt error code.
+ */
+int boot_time_update_fdt(void *fdt);
+
+#endif /*BOOT_TIME_H*/
@@ -18,6 +18,42 @@ aflags	 = -mcpu=$(cpuarch)
 
 libutil_with_isoc := y
 
+# Size optimized builds can keep the small C memcpy() instead of the
+# ARMv7 assembly version
+PREFER_SIZE_OVER_SPEED ?= n
+ifeq ($(PREFER_SIZE_OVER_SPEED),y)
+libutil_with_arm32_memcpy := n
+else
+libutil_with_arm32_memcpy := y
+endif
+
+# Verify the SHA-256 digests of the secure blob, kernel and rootfs against
+# a manifest generated at build time while they're copied in place
+BIOS_VERIFY_IMAGES ?= y
+
+# Apply the secure world fixups, and BIOS_NSEC_DTBO if set, to the DTB
+# linked in with BIOS_NSEC_DTB at build time instead of at every boot
+BIOS_NSEC_DTB_PREFIXUP ?= y
+
+# How the DTB passed to the kernel keeps it off the secure memory:
+#   carve		cut the secure ranges out of the memory nodes
+#   reserved-memory	add no-map subnodes of /reserved-memory instead
+#   memreserve		add /memreserve/ entries instead, the kernel still
+#			maps the ranges but doesn't allocate from them
+# reserved-memory and memreserve can be combined, both leave the memory
+# nodes untouched so the kernel sees contiguous memory banks.
+BIOS_TZ_MEM_DT ?= carve
+
+# Size of the static shared memory pool of OP-TEE, non-secure memory just
+# below the secure memory that's kept from the kernel, 0 for none. The
+# pool is passed in r3 (start) and r4 (size) at secure entry, so only set
+# this for an OP-TEE built to take its shared memory from those registers
+# rather than from its own configuration.
+BIOS_TZ_SHM_SIZE ?= 0
+
+# Use Advanced SIMD for the boot time copy routines
+WITH_NEON ?= y
+
 DEBUG		?= 1
 ifeq ($(DEBUG),1)
 cflags += -O0
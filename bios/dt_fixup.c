@@ -0,0 +1,1175 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "platform_config.h"
+
+#include <inttypes.h>
+#include <interval_set.h>
+#include <libfdt.h>
+#include <stdio.h>
+#include <string.h>
+#include "dt_fixup.h"
+#include "dt_match.h"
+#include "msg.h"
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+/* Room for the hashes of tz_res_devices[] */
+#define TZ_RES_DEVICES_MAX	4
+
+/*
+ * Secure memory kept from the normal world. The OP-TEE core and its pager
+ * pool are in TZ_RES_MEM, the other carve-outs are optional. node_name is
+ * that of the /reserved-memory subnode, without the unit address.
+ */
+static const struct tz_carve_out {
+	const char *name;
+	const char *node_name;
+	uint64_t start;
+	uint64_t size;
+} tz_carve_outs[] = {
+	{ "OP-TEE core and pager pool", "optee_core", TZ_RES_MEM_START,
+	  TZ_RES_MEM_SIZE },
+#ifdef TZ_SDP_MEM_START
+	{ "Secure data path buffers", "optee_sdp", TZ_SDP_MEM_START,
+	  TZ_SDP_MEM_SIZE },
+#endif
+};
+
+/*
+ * Non-secure memory next to TZ_RES_MEM that OP-TEE and the normal world
+ * driver share buffers in. Whatever BIOS_TZ_MEM_DT says, it's a no-map
+ * subnode of /reserved-memory that /firmware/optee refers to with its
+ * memory-region property.
+ */
+static const struct tz_carve_out tz_shm = {
+	"OP-TEE shared memory", "optee_shm", TZ_SHM_START, TZ_SHM_SIZE
+};
+#define TZ_SHM			(TZ_SHM_SIZE != 0)
+
+/*
+ * How the carve-outs are kept from the normal world, see BIOS_TZ_MEM_DT
+ * in conf.mk. Unless they're reserved, they're cut out of the reg of the
+ * memory nodes.
+ */
+#ifdef TZ_MEM_DT_RESERVED_MEMORY
+#define TZ_MEM_RESERVED_MEMORY	true
+#else
+#define TZ_MEM_RESERVED_MEMORY	false
+#endif
+#ifdef TZ_MEM_DT_MEMRESERVE
+#define TZ_MEM_MEMRESERVE	true
+#else
+#define TZ_MEM_MEMRESERVE	false
+#endif
+#define TZ_MEM_CARVE		(!TZ_MEM_RESERVED_MEMORY && !TZ_MEM_MEMRESERVE)
+
+/* Room for "<node_name>@<unit address>" */
+#define RESERVED_NAME_MAX	32
+
+/* Room for the banks of all memory nodes together */
+#define MEM_BANKS_MAX		16
+/* Room for the banks of one memory node once carved */
+#define MEM_CARVED_MAX		(MEM_BANKS_MAX + ARRAY_SIZE(tz_carve_outs))
+
+/*
+ * The secure carve-outs, and the banks of all memory nodes gathered while
+ * the carve-outs are removed from each node in turn.
+ */
+struct tz_mem_map {
+	struct interval secure_ivs[ARRAY_SIZE(tz_carve_outs)];
+	struct interval mem_ivs[MEM_BANKS_MAX];
+	struct interval_set secure;
+	struct interval_set mem;
+};
+
+/* Kept for dt_fixup_mem_map() once the fixups are done */
+static struct tz_mem_map tz_mem;
+
+static void tz_mem_map_init(struct tz_mem_map *map)
+{
+	const struct tz_carve_out *co;
+	bool ok;
+	size_t n;
+
+	interval_set_init(&map->secure, map->secure_ivs,
+			  ARRAY_SIZE(map->secure_ivs));
+	interval_set_init(&map->mem, map->mem_ivs, ARRAY_SIZE(map->mem_ivs));
+
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++) {
+		co = tz_carve_outs + n;
+		ok = interval_set_add(&map->secure, co->start,
+				      co->start + co->size);
+		CHECK(!ok);
+	}
+	interval_set_coalesce(&map->secure);
+}
+
+/* Both "memory" and "memory@<unit address>" */
+static bool is_memory_node(const char *name, int namelen)
+{
+	return namelen >= 6 && !memcmp(name, "memory", 6) &&
+	       (namelen == 6 || name[6] == '@');
+}
+
+/*
+ * Adds the banks in the reg of a memory node to the memory map and, if
+ * carved isn't NULL, sets carved, with room for MEM_CARVED_MAX ranges, to
+ * them minus the secure carve-outs.
+ */
+static void tz_res_mem_carve(struct tz_mem_map *map, const void *reg,
+			     int len, int addr_cells, int size_cells,
+			     struct interval_set *carved)
+{
+	struct interval node_ivs[MEM_BANKS_MAX];
+	struct interval_set node;
+	struct fdt_reg_iter iter;
+	struct fdt_reg bank;
+	uint64_t end;
+	size_t n;
+	bool ok;
+	int r;
+
+	r = fdt_reg_iter_init(&iter, reg, len, addr_cells, size_cells);
+	CHECK(r < 0);
+
+	interval_set_init(&node, node_ivs, ARRAY_SIZE(node_ivs));
+	msg("Original DTB memory: start len\n");
+	while (fdt_reg_iter_next(&iter, &bank)) {
+		msg("0x%" PRIx64 " 0x%" PRIx64 "\n", bank.address, bank.size);
+		end = bank.address + bank.size;
+		CHECK(end < bank.address);
+		ok = interval_set_add(&node, bank.address, end) &&
+		     interval_set_add(&map->mem, bank.address, end);
+		CHECK(!ok);
+	}
+	if (!carved)
+		return;
+	interval_set_coalesce(&node);
+
+	ok = interval_set_difference(carved, &node, &map->secure);
+	CHECK(!ok);
+
+	msg("Carved out TZ memory from DTB memory: start len\n");
+	for (n = 0; n < carved->num; n++)
+		msg("0x%" PRIx64 " 0x%" PRIx64 "\n", carved->ivs[n].start,
+		    carved->ivs[n].end - carved->ivs[n].start);
+}
+
+/* Encodes carved as a reg property at buf, of fdt_reg_size() bytes */
+static int tz_res_mem_encode(void *buf, int bufsize, int addr_cells,
+			     int size_cells, const struct interval_set *carved)
+{
+	struct fdt_reg regs[MEM_CARVED_MAX];
+	size_t n;
+
+	for (n = 0; n < carved->num; n++) {
+		regs[n].address = carved->ivs[n].start;
+		regs[n].size = carved->ivs[n].end - carved->ivs[n].start;
+	}
+	return fdt_reg_encode(buf, bufsize, addr_cells, size_cells, regs,
+			      carved->num);
+}
+
+/*
+ * Once the banks of all memory nodes are in the map, checks that they
+ * cover every secure carve-out.
+ */
+static void tz_res_mem_check_avail(struct tz_mem_map *map)
+{
+	const struct tz_carve_out *co;
+	size_t n;
+
+	interval_set_coalesce(&map->mem);
+
+	msg("Checking that secure memory is available\n");
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++) {
+		co = tz_carve_outs + n;
+		msg("%s: 0x%" PRIx64 " .. 0x%" PRIx64 "\n", co->name,
+		    co->start, co->start + co->size);
+	}
+	if (TZ_SHM)
+		msg("%s: 0x%" PRIx64 " .. 0x%" PRIx64 "\n", tz_shm.name,
+		    tz_shm.start, tz_shm.start + tz_shm.size);
+	msg("Available memory\n");
+	for (n = 0; n < map->mem.num; n++)
+		msg("0x%" PRIx64 " .. 0x%" PRIx64 "\n", map->mem.ivs[n].start,
+		    map->mem.ivs[n].end);
+
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++) {
+		co = tz_carve_outs + n;
+		if (!interval_set_covers(&map->mem, co->start,
+					 co->start + co->size)) {
+			msg("Can't find secure memory\n");
+			msg("0x%" PRIx64 " .. 0x%" PRIx64 "\n", co->start,
+			    co->start + co->size);
+			CHECK(1);
+		}
+	}
+	if (TZ_SHM) {
+		CHECK(!interval_set_covers(&map->mem, tz_shm.start,
+					   tz_shm.start + tz_shm.size));
+		/* Shared memory must stay outside of the secure memory */
+		for (n = 0; n < map->secure.num; n++)
+			CHECK(tz_shm.start < map->secure.ivs[n].end &&
+			      map->secure.ivs[n].start <
+					tz_shm.start + tz_shm.size);
+	}
+	msg("Secure memory is available\n");
+}
+
+static void reserved_name(char name[RESERVED_NAME_MAX],
+			  const struct tz_carve_out *co)
+{
+	snprintf(name, RESERVED_NAME_MAX, "%s@%" PRIx64, co->node_name,
+		 co->start);
+}
+
+/* The highest phandle in the tree, 0 if none */
+static uint32_t live_max_phandle(const struct fdt_live_tree *tree)
+{
+	static const char * const names[] = { "phandle", "linux,phandle" };
+	const struct fdt_live_node *node;
+	const void *val;
+	uint32_t max = 0;
+	uint32_t phandle;
+	size_t n;
+	int len;
+
+	for (node = tree->root; node; node = fdt_live_next_node(node)) {
+		for (n = 0; n < ARRAY_SIZE(names); n++) {
+			val = fdt_live_getprop(node, names[n], &len);
+			if (!val || len != sizeof(phandle))
+				continue;
+			memcpy(&phandle, val, sizeof(phandle));
+			phandle = fdt32_to_cpu(phandle);
+			if (phandle != (uint32_t)-1 && phandle > max)
+				max = phandle;
+			break;
+		}
+	}
+	return max;
+}
+
+/* A phandle for a new node, above max */
+static uint32_t new_phandle(uint32_t max)
+{
+	CHECK(max >= (uint32_t)-2);
+	return max + 1;
+}
+
+/*
+ * Returns /reserved-memory, added with the cells of the root node if the
+ * DTB lacks it, and the cells of its subnodes.
+ */
+static struct fdt_live_node *reserved_memory_node(struct fdt_live_tree *tree,
+			int *addr_cells, int *size_cells)
+{
+	struct fdt_live_node *resv;
+	void *p;
+	int r;
+
+	resv = fdt_live_subnode(tree->root, "reserved-memory");
+	if (resv) {
+		*addr_cells = fdt_live_address_cells(resv);
+		CHECK(*addr_cells < 0);
+		*size_cells = fdt_live_size_cells(resv);
+		CHECK(*size_cells < 0);
+		return resv;
+	}
+
+	r = fdt_live_add_subnode(tree, tree->root, "reserved-memory", &resv);
+	CHECK(r < 0);
+	r = fdt_live_setprop_u32(tree, resv, "#address-cells", *addr_cells);
+	CHECK(r < 0);
+	r = fdt_live_setprop_u32(tree, resv, "#size-cells", *size_cells);
+	CHECK(r < 0);
+	r = fdt_live_setprop_placeholder(tree, resv, "ranges", 0, &p);
+	CHECK(r < 0);
+	return resv;
+}
+
+/* Adds the no-map subnode of /reserved-memory for a carve-out */
+static struct fdt_live_node *tz_res_mem_reserve_one(
+			struct fdt_live_tree *tree, struct fdt_live_node *resv,
+			const struct tz_carve_out *co, int addr_cells,
+			int size_cells)
+{
+	struct fdt_live_node *node;
+	char name[RESERVED_NAME_MAX];
+	struct fdt_reg reg;
+	void *p;
+	int size = fdt_reg_size(addr_cells, size_cells, 1);
+	int r;
+
+	reserved_name(name, co);
+	msg("Reserving %s as /reserved-memory/%s\n", co->name, name);
+
+	/* Replaces a node the DTB may already have for it */
+	node = fdt_live_subnode(resv, name);
+	if (node) {
+		r = fdt_live_del_node(node);
+		CHECK(r < 0);
+	}
+	r = fdt_live_add_subnode(tree, resv, name, &node);
+	CHECK(r < 0);
+
+	reg.address = co->start;
+	reg.size = co->size;
+	r = fdt_live_setprop_placeholder(tree, node, "reg", size, &p);
+	CHECK(r < 0);
+	r = fdt_reg_encode(p, size, addr_cells, size_cells, &reg, 1);
+	CHECK(r < 0);
+	r = fdt_live_setprop_placeholder(tree, node, "no-map", 0, &p);
+	CHECK(r < 0);
+	return node;
+}
+
+/*
+ * Adds a no-map subnode of /reserved-memory for each carve-out if they're
+ * reserved that way, and one for the shared memory.
+ */
+static void tz_res_mem_reserve(struct fdt_live_tree *tree, int addr_cells,
+			       int size_cells)
+{
+	struct fdt_live_node *resv;
+	struct fdt_live_node *node;
+	size_t n;
+	int r;
+
+	resv = reserved_memory_node(tree, &addr_cells, &size_cells);
+
+	if (TZ_MEM_RESERVED_MEMORY)
+		for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++)
+			tz_res_mem_reserve_one(tree, resv, tz_carve_outs + n,
+					       addr_cells, size_cells);
+
+	if (TZ_SHM) {
+		node = tz_res_mem_reserve_one(tree, resv, &tz_shm,
+					      addr_cells, size_cells);
+		r = fdt_live_setprop_u32(tree, node, "phandle",
+					 new_phandle(live_max_phandle(tree)));
+		CHECK(r < 0);
+	}
+}
+
+static void tz_res_mem_memreserve(struct fdt_live_tree *tree)
+{
+	const struct tz_carve_out *co;
+	size_t n;
+	int r;
+
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++) {
+		co = tz_carve_outs + n;
+		msg("Reserving %s with /memreserve/\n", co->name);
+		r = fdt_live_add_mem_rsv(tree, co->start, co->size);
+		CHECK(r < 0);
+	}
+}
+
+void dt_fixup_tz_res_mem(struct fdt_live_tree *tree)
+{
+	struct interval carved_ivs[MEM_CARVED_MAX];
+	struct interval_set carved;
+	struct fdt_live_node *node;
+	const void *prop;
+	void *p;
+	int len;
+	int r;
+	int size;
+	int addr_cells;
+	int size_cells;
+
+	addr_cells = fdt_live_address_cells(tree->root);
+	CHECK(addr_cells < 0);
+	size_cells = fdt_live_size_cells(tree->root);
+	CHECK(size_cells < 0);
+
+	tz_mem_map_init(&tz_mem);
+	for (node = tree->root->child; node; node = node->sibling) {
+		if (!is_memory_node(node->name, node->namelen))
+			continue;
+
+		prop = fdt_live_getprop(node, "reg", &len);
+		CHECK(!prop);
+
+		if (!TZ_MEM_CARVE) {
+			tz_res_mem_carve(&tz_mem, prop, len, addr_cells,
+					 size_cells, NULL);
+			continue;
+		}
+
+		interval_set_init(&carved, carved_ivs, ARRAY_SIZE(carved_ivs));
+		tz_res_mem_carve(&tz_mem, prop, len, addr_cells, size_cells,
+				 &carved);
+
+		size = fdt_reg_size(addr_cells, size_cells, carved.num);
+		r = fdt_live_setprop_placeholder(tree, node, "reg", size, &p);
+		CHECK(r < 0);
+		r = tz_res_mem_encode(p, size, addr_cells, size_cells,
+				      &carved);
+		CHECK(r < 0);
+	}
+	tz_res_mem_check_avail(&tz_mem);
+
+	if (TZ_MEM_RESERVED_MEMORY || TZ_SHM)
+		tz_res_mem_reserve(tree, addr_cells, size_cells);
+	if (TZ_MEM_MEMRESERVE)
+		tz_res_mem_memreserve(tree);
+}
+
+#ifdef TZ_UART_SHARED
+void dt_fixup_tz_res_uart(struct fdt_live_tree *tree)
+{
+	(void)tree;
+	msg("Uart shared between secure and non-secure world\n");
+}
+
+static void tz_res_devices_init(uint32_t *hashes)
+{
+	(void)hashes;
+	msg("Uart shared between secure and non-secure world\n");
+}
+
+static const struct dt_match *tz_res_device(const void *fdt, int offs,
+			int addr_cells, const uint32_t *hashes)
+{
+	(void)fdt;
+	(void)offs;
+	(void)addr_cells;
+	(void)hashes;
+	return NULL;
+}
+#else
+
+/*
+ * Devices reserved for the secure world, all of them are looked up in a
+ * single walk of the DTB.
+ */
+static const struct dt_match tz_res_devices[] = {
+	{ .compatible = "arm,pl011", .reg_base = UART1_BASE,
+	  .action = DT_MATCH_DELETE },
+};
+
+void dt_fixup_tz_res_uart(struct fdt_live_tree *tree)
+{
+	struct dt_match_node nodes[8];
+	size_t n;
+	int num;
+	int r;
+
+	num = dt_match_find(tree, tz_res_devices, ARRAY_SIZE(tz_res_devices),
+			    nodes, ARRAY_SIZE(nodes));
+	CHECK(num < 0);
+
+	for (n = 0; n < (size_t)num; n++)
+		msg("Removing node \"%.*s\" from DTB passed to kernel\n",
+		    nodes[n].node->namelen, nodes[n].node->name);
+
+	r = dt_match_apply(tree, nodes, num);
+	CHECK(r < 0);
+}
+
+static void tz_res_devices_init(uint32_t *hashes)
+{
+	CHECK(ARRAY_SIZE(tz_res_devices) > TZ_RES_DEVICES_MAX);
+	dt_match_hash_table(tz_res_devices, ARRAY_SIZE(tz_res_devices),
+			    hashes);
+}
+
+static const struct dt_match *tz_res_device(const void *fdt, int offs,
+			int addr_cells, const uint32_t *hashes)
+{
+	return dt_match_fdt_node(fdt, offs, addr_cells, tz_res_devices,
+				 hashes, ARRAY_SIZE(tz_res_devices));
+}
+#endif
+
+void dt_fixup_optee_node(struct fdt_live_tree *tree)
+{
+	struct fdt_live_node *firmware;
+	struct fdt_live_node *optee;
+	struct fdt_live_node *shm;
+	char name[RESERVED_NAME_MAX];
+	const void *phandle;
+	int len;
+	int ret;
+
+	firmware = fdt_live_subnode(tree->root, "firmware");
+	if (!firmware) {
+		ret = fdt_live_add_subnode(tree, tree->root, "firmware",
+					   &firmware);
+		CHECK(ret < 0);
+	}
+	ret = fdt_live_add_subnode(tree, firmware, "optee", &optee);
+	CHECK(ret < 0);
+	ret = fdt_live_setprop_string(tree, optee, "compatible",
+				      "linaro,optee-tz");
+	CHECK(ret < 0);
+	ret = fdt_live_setprop_string(tree, optee, "method", "smc");
+	CHECK(ret < 0);
+
+	if (TZ_SHM) {
+		/* Added by dt_fixup_tz_res_mem() */
+		reserved_name(name, &tz_shm);
+		shm = fdt_live_subnode(tree->root, "reserved-memory");
+		if (shm)
+			shm = fdt_live_subnode(shm, name);
+		CHECK(!shm);
+		phandle = fdt_live_getprop(shm, "phandle", &len);
+		CHECK(!phandle || len != sizeof(uint32_t));
+		ret = fdt_live_setprop(tree, optee, "memory-region", phandle,
+				       len);
+		CHECK(ret < 0);
+	}
+}
+
+/*
+ * The build configuration the fixups depend on: the secure UART base or 0
+ * if it's shared, how secure memory is kept from the normal world, then
+ * the 64-bit start and size of each secure carve-out and of the shared
+ * memory.
+ */
+#define PREFIXED_CONFIG_CELLS	(2 + 4 * (ARRAY_SIZE(tz_carve_outs) + 1))
+
+static void config_range(fdt32_t cfg[4], const struct tz_carve_out *co)
+{
+	cfg[0] = cpu_to_fdt32(co->start >> 32);
+	cfg[1] = cpu_to_fdt32((uint32_t)co->start);
+	cfg[2] = cpu_to_fdt32(co->size >> 32);
+	cfg[3] = cpu_to_fdt32((uint32_t)co->size);
+}
+
+static void prefixed_config(fdt32_t cfg[PREFIXED_CONFIG_CELLS])
+{
+	size_t n;
+
+#ifdef TZ_UART_SHARED
+	cfg[0] = cpu_to_fdt32(0);
+#else
+	cfg[0] = cpu_to_fdt32(UART1_BASE);
+#endif
+	cfg[1] = cpu_to_fdt32(TZ_MEM_RESERVED_MEMORY | TZ_MEM_MEMRESERVE << 1);
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++)
+		config_range(cfg + 2 + 4 * n, tz_carve_outs + n);
+	config_range(cfg + 2 + 4 * n, &tz_shm);
+}
+
+void dt_fixup_mark_prefixed(struct fdt_live_tree *tree)
+{
+	fdt32_t cfg[PREFIXED_CONFIG_CELLS];
+	int r;
+
+	prefixed_config(cfg);
+	r = fdt_live_setprop(tree, tree->root, DT_FIXUP_PREFIXED_PROP, cfg,
+			     sizeof(cfg));
+	CHECK(r < 0);
+}
+
+static bool prefixed_config_matches(const void *val, int len)
+{
+	fdt32_t cfg[PREFIXED_CONFIG_CELLS];
+
+	if (!val || len != sizeof(cfg))
+		return false;
+
+	prefixed_config(cfg);
+	return !memcmp(val, cfg, sizeof(cfg));
+}
+
+bool dt_fixup_is_prefixed(const struct fdt_live_tree *tree)
+{
+	const void *val;
+	int len;
+
+	val = fdt_live_getprop(tree->root, DT_FIXUP_PREFIXED_PROP, &len);
+	return prefixed_config_matches(val, len);
+}
+
+bool dt_fixup_fdt_is_prefixed(const void *fdt)
+{
+	const void *val;
+	int len;
+
+	val = fdt_getprop_unchecked(fdt, 0, DT_FIXUP_PREFIXED_PROP, &len);
+	return prefixed_config_matches(val, len);
+}
+
+/*
+ * State of dt_fixup_stream(), the offsets are those of the nodes in the
+ * source blob that the fixups apply to.
+ */
+struct fixup_stream {
+	bool secure;
+	int memory;
+	int addr_cells;
+	int size_cells;
+	int firmware;
+	int reserved;
+	int reserved_addr_cells;
+	int reserved_size_cells;
+	uint32_t shm_phandle;
+	int disabled;
+	struct fdt_cells cells;
+	uint32_t hashes[TZ_RES_DEVICES_MAX];
+	int chosen;
+	const struct fdt_stream_ops *chosen_ops;
+	void *chosen_arg;
+};
+
+/* True for the /reserved-memory subnode of a carve-out or shared memory */
+static bool is_reserved_node(const char *name)
+{
+	char rname[RESERVED_NAME_MAX];
+	size_t n;
+
+	for (n = 0; TZ_MEM_RESERVED_MEMORY && n < ARRAY_SIZE(tz_carve_outs);
+	     n++) {
+		reserved_name(rname, tz_carve_outs + n);
+		if (!strcmp(name, rname))
+			return true;
+	}
+	if (TZ_SHM) {
+		reserved_name(rname, &tz_shm);
+		if (!strcmp(name, rname))
+			return true;
+	}
+	return false;
+}
+
+static int stream_node(void *arg, void *out, const void *fdt, int offs,
+		       int parent)
+{
+	struct fixup_stream *fs = arg;
+	const struct dt_match *m;
+	int r;
+
+	(void)out;
+	if (parent < 0)
+		return 0;
+
+	if (parent == 0) {
+		const char *name = fdt_get_name_unchecked(fdt, offs);
+
+		if (is_memory_node(name, strlen(name)))
+			fs->memory = offs;
+	}
+
+	if (!fs->secure)
+		return 0;
+
+	/* Replaced by the end_props callback */
+	if (parent == fs->reserved &&
+	    is_reserved_node(fdt_get_name_unchecked(fdt, offs)))
+		return FDT_STREAM_SKIP;
+
+	/* Siblings share the cells of the parent, bad ones match no base */
+	r = fdt_cells_get(fdt, parent, &fs->cells);
+	m = tz_res_device(fdt, offs, r < 0 ? 0 : fs->cells.addr_cells,
+			  fs->hashes);
+	if (!m)
+		return 0;
+
+	switch (m->action) {
+	case DT_MATCH_DELETE:
+		msg("Removing node \"%s\" from DTB passed to kernel\n",
+		    fdt_get_name_unchecked(fdt, offs));
+		return FDT_STREAM_SKIP;
+	case DT_MATCH_DISABLE:
+		fs->disabled = offs;
+		return 0;
+	default:
+		return -FDT_ERR_INTERNAL;
+	}
+}
+
+/*
+ * Returns FDT_STREAM_SKIP if it wrote the carved reg, 0 to copy it. The
+ * reg of a DTB fixed up at build time is only added to the memory map.
+ */
+static int stream_memory_reg(struct fixup_stream *fs, void *out,
+			     const void *prop, int len)
+{
+	struct interval carved_ivs[MEM_CARVED_MAX];
+	struct interval_set carved;
+	void *p;
+	int size;
+	int r;
+
+	if (!fs->secure || !TZ_MEM_CARVE) {
+		tz_res_mem_carve(&tz_mem, prop, len, fs->addr_cells,
+				 fs->size_cells, NULL);
+		return 0;
+	}
+
+	interval_set_init(&carved, carved_ivs, ARRAY_SIZE(carved_ivs));
+	tz_res_mem_carve(&tz_mem, prop, len, fs->addr_cells, fs->size_cells,
+			 &carved);
+
+	size = fdt_reg_size(fs->addr_cells, fs->size_cells, carved.num);
+	r = fdt_property_placeholder(out, "reg", size, &p);
+	if (r < 0)
+		return r;
+	r = tz_res_mem_encode(p, size, fs->addr_cells, fs->size_cells,
+			      &carved);
+	return r < 0 ? r : FDT_STREAM_SKIP;
+}
+
+static int stream_property(void *arg, void *out, const void *fdt, int offs,
+			   const char *name, const void *val, int len)
+{
+	struct fixup_stream *fs = arg;
+
+	if (offs == fs->chosen) {
+		if (!fs->chosen_ops->property)
+			return 0;
+		return fs->chosen_ops->property(fs->chosen_arg, out, fdt, offs,
+						name, val, len);
+	}
+
+	if (offs == fs->memory && !strcmp(name, "reg"))
+		return stream_memory_reg(fs, out, val, len);
+
+	if (!fs->secure)
+		return 0;
+
+	/* Replaced by the end_props callback */
+	if (offs == fs->disabled && !strcmp(name, "status"))
+		return FDT_STREAM_SKIP;
+
+	return 0;
+}
+
+static int stream_optee_node(struct fixup_stream *fs, void *out)
+{
+	int r;
+
+	r = fdt_begin_node(out, "optee");
+	if (r < 0)
+		return r;
+	r = fdt_property_string(out, "compatible", "linaro,optee-tz");
+	if (r < 0)
+		return r;
+	r = fdt_property_string(out, "method", "smc");
+	if (r < 0)
+		return r;
+	if (TZ_SHM) {
+		r = fdt_property_u32(out, "memory-region", fs->shm_phandle);
+		if (r < 0)
+			return r;
+	}
+	return fdt_end_node(out);
+}
+
+/* A no-map subnode of /reserved-memory, as tz_res_mem_reserve_one() */
+static int stream_reserved_subnode(void *out, const struct tz_carve_out *co,
+				   int addr_cells, int size_cells,
+				   uint32_t phandle)
+{
+	char name[RESERVED_NAME_MAX];
+	struct fdt_reg reg;
+	void *p;
+	int size = fdt_reg_size(addr_cells, size_cells, 1);
+	int r;
+
+	reserved_name(name, co);
+	msg("Reserving %s as /reserved-memory/%s\n", co->name, name);
+
+	r = fdt_begin_node(out, name);
+	if (r < 0)
+		return r;
+	reg.address = co->start;
+	reg.size = co->size;
+	r = fdt_property_placeholder(out, "reg", size, &p);
+	if (r < 0)
+		return r;
+	r = fdt_reg_encode(p, size, addr_cells, size_cells, &reg, 1);
+	if (r < 0)
+		return r;
+	r = fdt_property_placeholder(out, "no-map", 0, &p);
+	if (r < 0)
+		return r;
+	if (phandle) {
+		r = fdt_property_u32(out, "phandle", phandle);
+		if (r < 0)
+			return r;
+	}
+	return fdt_end_node(out);
+}
+
+/* The subnodes of /reserved-memory, as tz_res_mem_reserve() */
+static int stream_reserved_subnodes(struct fixup_stream *fs, void *out,
+				    int addr_cells, int size_cells)
+{
+	size_t n;
+	int r;
+
+	for (n = 0; TZ_MEM_RESERVED_MEMORY && n < ARRAY_SIZE(tz_carve_outs);
+	     n++) {
+		r = stream_reserved_subnode(out, tz_carve_outs + n,
+					    addr_cells, size_cells, 0);
+		if (r < 0)
+			return r;
+	}
+	if (TZ_SHM)
+		return stream_reserved_subnode(out, &tz_shm, addr_cells,
+					       size_cells, fs->shm_phandle);
+	return 0;
+}
+
+static int stream_reserved_node(struct fixup_stream *fs, void *out)
+{
+	void *p;
+	int r;
+
+	r = fdt_begin_node(out, "reserved-memory");
+	if (r < 0)
+		return r;
+	r = fdt_property_u32(out, "#address-cells", fs->addr_cells);
+	if (r < 0)
+		return r;
+	r = fdt_property_u32(out, "#size-cells", fs->size_cells);
+	if (r < 0)
+		return r;
+	r = fdt_property_placeholder(out, "ranges", 0, &p);
+	if (r < 0)
+		return r;
+	r = stream_reserved_subnodes(fs, out, fs->addr_cells,
+				     fs->size_cells);
+	if (r < 0)
+		return r;
+	return fdt_end_node(out);
+}
+
+static int stream_chosen_props(struct fixup_stream *fs, void *out,
+			       const void *fdt, int offs)
+{
+	if (!fs->chosen_ops->end_props)
+		return 0;
+	return fs->chosen_ops->end_props(fs->chosen_arg, out, fdt, offs);
+}
+
+/* Nodes added to the root node, if the source blob lacks them */
+static int stream_root_subnodes(struct fixup_stream *fs, void *out,
+				const void *fdt)
+{
+	int r;
+
+	if (fs->secure && fs->firmware < 0) {
+		r = fdt_begin_node(out, "firmware");
+		if (r < 0)
+			return r;
+		r = stream_optee_node(fs, out);
+		if (r < 0)
+			return r;
+		r = fdt_end_node(out);
+		if (r < 0)
+			return r;
+	}
+
+	if (fs->secure && (TZ_MEM_RESERVED_MEMORY || TZ_SHM) &&
+	    fs->reserved < 0) {
+		r = stream_reserved_node(fs, out);
+		if (r < 0)
+			return r;
+	}
+
+	if (fs->chosen < 0) {
+		r = fdt_begin_node(out, "chosen");
+		if (r < 0)
+			return r;
+		r = stream_chosen_props(fs, out, fdt, fs->chosen);
+		if (r < 0)
+			return r;
+		r = fdt_end_node(out);
+		if (r < 0)
+			return r;
+	}
+
+	return 0;
+}
+
+static int stream_end_props(void *arg, void *out, const void *fdt, int offs)
+{
+	struct fixup_stream *fs = arg;
+
+	if (offs == 0)
+		return stream_root_subnodes(fs, out, fdt);
+	if (offs == fs->chosen)
+		return stream_chosen_props(fs, out, fdt, offs);
+	if (!fs->secure)
+		return 0;
+	if (offs == fs->firmware)
+		return stream_optee_node(fs, out);
+	if (offs == fs->reserved)
+		return stream_reserved_subnodes(fs, out,
+						fs->reserved_addr_cells,
+						fs->reserved_size_cells);
+	if (offs == fs->disabled)
+		return fdt_property_string(out, "status", "disabled");
+	return 0;
+}
+
+static int stream_mem_rsv(void *arg, void *out, const void *fdt)
+{
+	struct fixup_stream *fs = arg;
+	const struct tz_carve_out *co;
+	size_t n;
+	int r;
+
+	(void)fdt;
+	if (!fs->secure || !TZ_MEM_MEMRESERVE)
+		return 0;
+
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++) {
+		co = tz_carve_outs + n;
+		msg("Reserving %s with /memreserve/\n", co->name);
+		r = fdt_add_reservemap_entry(out, co->start, co->size);
+		if (r < 0)
+			return r;
+	}
+	return 0;
+}
+
+static const struct fdt_stream_ops fixup_stream_ops = {
+	.node = stream_node,
+	.property = stream_property,
+	.end_props = stream_end_props,
+	.mem_rsv = stream_mem_rsv,
+};
+
+/* The cells of an existing /reserved-memory, for the subnodes added */
+static void stream_reserved_init(struct fixup_stream *fs, const void *fdt)
+{
+	static const char * const cells_props[] = {
+		"#address-cells", "#size-cells",
+	};
+	const void *vals[ARRAY_SIZE(cells_props)];
+	int lens[ARRAY_SIZE(cells_props)];
+
+	fs->reserved = -1;
+	if (!TZ_MEM_RESERVED_MEMORY && !TZ_SHM)
+		return;
+
+	fs->reserved = fdt_subnode_offset_unchecked(fdt, 0,
+						    "reserved-memory");
+	if (fs->reserved < 0)
+		return;
+
+	fdt_getprops_unchecked(fdt, fs->reserved, cells_props,
+			       ARRAY_SIZE(cells_props), vals, lens);
+	fs->reserved_addr_cells = fdt_address_cells_val(vals[0], lens[0]);
+	CHECK(fs->reserved_addr_cells < 0);
+	fs->reserved_size_cells = fdt_size_cells_val(vals[1], lens[1]);
+	CHECK(fs->reserved_size_cells < 0);
+}
+
+int dt_fixup_stream(const void *fdt, void *buf, int bufsize,
+		    const struct fdt_stream_ops *chosen_ops, void *chosen_arg)
+{
+	static const char * const root_props[] = {
+		DT_FIXUP_PREFIXED_PROP, "#address-cells", "#size-cells",
+	};
+	const void *vals[ARRAY_SIZE(root_props)];
+	int lens[ARRAY_SIZE(root_props)];
+	struct fixup_stream fs;
+	uint32_t max;
+	int r;
+
+	fdt_getprops_unchecked(fdt, 0, root_props, ARRAY_SIZE(root_props),
+			       vals, lens);
+
+	memset(&fs, 0, sizeof(fs));
+	fs.secure = !prefixed_config_matches(vals[0], lens[0]);
+	fs.memory = -1;
+	fs.disabled = -1;
+	fs.cells = (struct fdt_cells)FDT_CELLS_INIT;
+	fs.chosen = fdt_subnode_offset_unchecked(fdt, 0, "chosen");
+	fs.chosen_ops = chosen_ops;
+	fs.chosen_arg = chosen_arg;
+	fs.addr_cells = fdt_address_cells_val(vals[1], lens[1]);
+	CHECK(fs.addr_cells < 0);
+	fs.size_cells = fdt_size_cells_val(vals[2], lens[2]);
+	CHECK(fs.size_cells < 0);
+	tz_mem_map_init(&tz_mem);
+
+	if (fs.secure) {
+		fs.firmware = fdt_subnode_offset_unchecked(fdt, 0, "firmware");
+		stream_reserved_init(&fs, fdt);
+		tz_res_devices_init(fs.hashes);
+		if (TZ_SHM) {
+			r = fdt_find_max_phandle(fdt, &max);
+			if (r < 0)
+				return r;
+			fs.shm_phandle = new_phandle(max);
+		}
+	} else {
+		msg("DTB was fixed up at build time\n");
+		fs.firmware = -1;
+		fs.reserved = -1;
+	}
+
+	r = fdt_stream(fdt, buf, bufsize, &fixup_stream_ops, &fs);
+	if (r < 0)
+		return r;
+
+	if (fs.secure)
+		tz_res_mem_check_avail(&tz_mem);
+	else
+		interval_set_coalesce(&tz_mem.mem);
+	return 0;
+}
+
+bool dt_fixup_mem_map(struct interval_set *secure, struct interval_set *nsec)
+{
+	size_t n;
+
+	for (n = 0; n < tz_mem.secure.num; n++)
+		if (!interval_set_insert(secure, tz_mem.secure.ivs[n].start,
+					 tz_mem.secure.ivs[n].end))
+			return false;
+
+	if (!interval_set_difference(nsec, &tz_mem.mem, &tz_mem.secure))
+		return false;
+	return !TZ_SHM || interval_set_subtract(nsec, tz_shm.start,
+						tz_shm.start + tz_shm.size);
+}
+
+/* As the kernel, ignores nodes with a status other than "okay" */
+static bool fdt_node_available(const void *fdt, int offs)
+{
+	const char *status;
+	int len;
+
+	status = fdt_getprop_unchecked(fdt, offs, "status", &len);
+	return !status || fdt_stringlist_contains(status, len, "okay") ||
+	       fdt_stringlist_contains(status, len, "ok");
+}
+
+/*
+ * The /memreserve/ entries and the statically placed /reserved-memory
+ * regions of fdt. Regions the kernel allocates itself, with a size but
+ * no reg, are left out, the kernel keeps them clear of the DTB and the
+ * rootfs.
+ */
+static bool fdt_reserved_ranges(const void *fdt, struct interval_set *reserved)
+{
+	static const char * const cells_props[] = {
+		"#address-cells", "#size-cells",
+	};
+	const void *vals[ARRAY_SIZE(cells_props)];
+	int lens[ARRAY_SIZE(cells_props)];
+	struct fdt_reg_iter iter;
+	struct fdt_reg region;
+	const void *reg;
+	uint64_t addr;
+	uint64_t size;
+	int resv;
+	int offs;
+	int len;
+	int n;
+	int r;
+
+	for (n = 0; n < fdt_num_mem_rsv(fdt); n++) {
+		r = fdt_get_mem_rsv(fdt, n, &addr, &size);
+		CHECK(r < 0);
+		if (size && !interval_set_insert(reserved, addr, addr + size))
+			return false;
+	}
+
+	resv = fdt_subnode_offset_unchecked(fdt, 0, "reserved-memory");
+	if (resv < 0)
+		return true;
+
+	fdt_getprops_unchecked(fdt, resv, cells_props,
+			       ARRAY_SIZE(cells_props), vals, lens);
+	for (offs = fdt_first_subnode(fdt, resv); offs >= 0;
+	     offs = fdt_next_subnode(fdt, offs)) {
+		reg = fdt_getprop_unchecked(fdt, offs, "reg", &len);
+		if (!reg || !fdt_node_available(fdt, offs))
+			continue;
+		r = fdt_reg_iter_init(&iter, reg, len,
+				      fdt_address_cells_val(vals[0], lens[0]),
+				      fdt_size_cells_val(vals[1], lens[1]));
+		CHECK(r < 0);
+		while (fdt_reg_iter_next(&iter, &region))
+			if (region.size &&
+			    !interval_set_insert(reserved, region.address,
+						 region.address + region.size))
+				return false;
+	}
+	return true;
+}
+
+bool dt_fixup_fdt_mem_map(const void *fdt, struct interval_set *mem,
+			  struct interval_set *reserved)
+{
+	static const char * const root_props[] = {
+		"#address-cells", "#size-cells",
+	};
+	const void *vals[ARRAY_SIZE(root_props)];
+	int lens[ARRAY_SIZE(root_props)];
+	struct fdt_reg_iter iter;
+	struct fdt_reg bank;
+	const char *name;
+	const void *reg;
+	size_t n;
+	int offs;
+	int len;
+	int r;
+
+	fdt_getprops_unchecked(fdt, 0, root_props, ARRAY_SIZE(root_props),
+			       vals, lens);
+
+	for (offs = fdt_first_subnode(fdt, 0); offs >= 0;
+	     offs = fdt_next_subnode(fdt, offs)) {
+		name = fdt_get_name_unchecked(fdt, offs);
+		if (!is_memory_node(name, strlen(name)))
+			continue;
+
+		reg = fdt_getprop_unchecked(fdt, offs, "reg", &len);
+		CHECK(!reg);
+		r = fdt_reg_iter_init(&iter, reg, len,
+				      fdt_address_cells_val(vals[0], lens[0]),
+				      fdt_size_cells_val(vals[1], lens[1]));
+		CHECK(r < 0);
+		while (fdt_reg_iter_next(&iter, &bank))
+			if (!interval_set_insert(mem, bank.address,
+						 bank.address + bank.size))
+				return false;
+	}
+
+	if (!fdt_reserved_ranges(fdt, reserved))
+		return false;
+
+	for (n = 0; n < ARRAY_SIZE(tz_carve_outs); n++)
+		if (!interval_set_insert(reserved, tz_carve_outs[n].start,
+					 tz_carve_outs[n].start +
+					 tz_carve_outs[n].size))
+			return false;
+	return !TZ_SHM || interval_set_insert(reserved, tz_shm.start,
+					      tz_shm.start + tz_shm.size);
+}
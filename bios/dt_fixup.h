@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef DT_FIXUP_H
+#define DT_FIXUP_H
+
+#include <interval_set.h>
+#include <libfdt.h>
+#include <types_ext.h>
+
+/*
+ * Fixups of the DTB passed to the normal world kernel, shared by the BIOS
+ * and the dtb_prefixup host tool.
+ */
+
+/*
+ * Keeps the normal world off the secure memory, by carving it out of the
+ * reg of every memory node or by reserving it as BIOS_TZ_MEM_DT selects,
+ * and checks that the memory nodes cover all of it. The OP-TEE shared
+ * memory, if any, is reserved in /reserved-memory.
+ */
+void dt_fixup_tz_res_mem(struct fdt_live_tree *tree);
+
+/* Removes the devices reserved for the secure world */
+void dt_fixup_tz_res_uart(struct fdt_live_tree *tree);
+
+/*
+ * Adds /firmware/optee, referring to the shared memory reserved by
+ * dt_fixup_tz_res_mem()
+ */
+void dt_fixup_optee_node(struct fdt_live_tree *tree);
+
+/*
+ * A DTB fixed up at build time has DT_FIXUP_PREFIXED_PROP in the root
+ * node, with the configuration the fixups were done for: the base of the
+ * secure UART or 0 if it's shared, how secure memory is kept from the
+ * normal world, and the start and size of each secure memory carve-out
+ * and of the shared memory.
+ */
+#define DT_FIXUP_PREFIXED_PROP	"bios,prefixed"
+
+void dt_fixup_mark_prefixed(struct fdt_live_tree *tree);
+
+/* True if the tree was fixed up at build time for this configuration */
+bool dt_fixup_is_prefixed(const struct fdt_live_tree *tree);
+
+/* As dt_fixup_is_prefixed(), fdt must have passed fdt_check_full() */
+bool dt_fixup_fdt_is_prefixed(const void *fdt);
+
+/*
+ * Writes the kernel DTB at buf in a single pass over fdt with
+ * fdt_stream(), doing the fixups above on the way unless fdt was fixed
+ * up at build time. fdt must have passed fdt_check_full(). The property
+ * and end_props callbacks of chosen_ops are called for /chosen, which is
+ * added if fdt has none. Returns 0 or a negative libfdt error,
+ * fdt_totalsize() of buf is the exact size.
+ */
+int dt_fixup_stream(const void *fdt, void *buf, int bufsize,
+		    const struct fdt_stream_ops *chosen_ops, void *chosen_arg);
+
+/*
+ * The memory map resolved by dt_fixup_tz_res_mem() or dt_fixup_stream(),
+ * added to the empty coalesced sets secure and nsec: the secure
+ * carve-outs, and the banks of the memory nodes less the carve-outs and
+ * the shared memory. Returns false if either set is full.
+ */
+bool dt_fixup_mem_map(struct interval_set *secure, struct interval_set *nsec);
+
+/*
+ * Adds the banks of the memory nodes of fdt, as they are before any
+ * fixup, to the empty coalesced set mem. Adds the /memreserve/ entries
+ * and the /reserved-memory regions with a reg of fdt, the secure
+ * carve-outs and the shared memory to reserved. fdt must have passed
+ * fdt_check_full(). Returns false if either set is full.
+ */
+bool dt_fixup_fdt_mem_map(const void *fdt, struct interval_set *mem,
+			  struct interval_set *reserved);
+
+#endif /*DT_FIXUP_H*/
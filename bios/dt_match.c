@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <libfdt.h>
+#include <string.h>
+#include "dt_match.h"
+#include "msg.h"
+
+static bool get_base(const void *reg, int rlen, int addr_cells,
+		     uint64_t *base)
+{
+	if (addr_cells < 1 || addr_cells > FDT_MAX_NCELLS ||
+	    rlen < addr_cells * (int)sizeof(fdt32_t))
+		return false;
+
+	*base = fdt_read_cells(reg, addr_cells);
+	return true;
+}
+
+/* Returns the first entry in the table matching the node */
+static const struct dt_match *match_node(const struct dt_match *table,
+			const uint32_t *hashes, size_t num_entries,
+			const char *compat, int clen, bool have_base,
+			uint64_t base)
+{
+	size_t best = num_entries;
+
+	while (clen > 0) {
+		size_t l = strnlen(compat, clen);
+		uint32_t h;
+		size_t n;
+
+		if ((int)l >= clen)
+			break;	/* Not NUL terminated */
+		h = fdt_fnv1a(compat, l);
+
+		for (n = 0; n < best; n++) {
+			if (hashes[n] != h ||
+			    memcmp(table[n].compatible, compat, l + 1))
+				continue;
+			if (table[n].reg_base == DT_MATCH_ANY_BASE ||
+			    (have_base && table[n].reg_base == base))
+				best = n;
+		}
+		compat += l + 1;
+		clen -= l + 1;
+	}
+	return best < num_entries ? &table[best] : NULL;
+}
+
+void dt_match_hash_table(const struct dt_match *table, size_t num_entries,
+			 uint32_t *hashes)
+{
+	size_t n;
+
+	for (n = 0; n < num_entries; n++)
+		hashes[n] = fdt_fnv1a(table[n].compatible,
+				      strlen(table[n].compatible));
+}
+
+const struct dt_match *dt_match_fdt_node(const void *fdt, int nodeoffset,
+			int addr_cells, const struct dt_match *table,
+			const uint32_t *hashes, size_t num_entries)
+{
+	static const char * const names[] = { "compatible", "reg" };
+	const void *vals[2];
+	int lens[2];
+	uint64_t base = 0;
+	bool have_base = false;
+
+	/* One pass over the properties picks up both */
+	fdt_getprops_unchecked(fdt, nodeoffset, names, 2, vals, lens);
+	if (!vals[0])
+		return NULL;
+
+	if (vals[1])
+		have_base = get_base(vals[1], lens[1], addr_cells, &base);
+
+	return match_node(table, hashes, num_entries, vals[0], lens[0],
+			  have_base, base);
+}
+
+int dt_match_find(const struct fdt_live_tree *tree,
+		  const struct dt_match *table, size_t num_entries,
+		  struct dt_match_node *nodes, size_t max_nodes)
+{
+	uint32_t hashes[DT_MATCH_TABLE_MAX];
+	const struct fdt_live_node *cells_node = NULL;
+	int cells = 2;
+	struct fdt_live_node *node;
+	size_t num_nodes = 0;
+
+	CHECK(num_entries > DT_MATCH_TABLE_MAX);
+	dt_match_hash_table(table, num_entries, hashes);
+
+	for (node = tree->root; node; node = fdt_live_next_node(node)) {
+		const struct fdt_live_prop *prop;
+		const char *compat = NULL;
+		const void *reg = NULL;
+		int clen = 0;
+		int rlen = 0;
+		const struct dt_match *m;
+		uint64_t base = 0;
+		bool have_base = false;
+
+		/* One pass over the properties picks up both */
+		for (prop = node->props; prop; prop = prop->next) {
+			if (!strcmp(prop->name->str, "compatible")) {
+				compat = prop->val;
+				clen = prop->len;
+			} else if (!strcmp(prop->name->str, "reg")) {
+				reg = prop->val;
+				rlen = prop->len;
+			}
+		}
+		if (!compat)
+			continue;
+
+		if (reg && node->parent) {
+			/* Siblings share the #address-cells of the parent */
+			if (node->parent != cells_node) {
+				cells_node = node->parent;
+				cells = fdt_live_address_cells(cells_node);
+			}
+			have_base = get_base(reg, rlen, cells, &base);
+		}
+
+		m = match_node(table, hashes, num_entries, compat, clen,
+			       have_base, base);
+		if (!m)
+			continue;
+		if (num_nodes >= max_nodes)
+			return -FDT_ERR_NOSPACE;
+		nodes[num_nodes].node = node;
+		nodes[num_nodes].match = m;
+		num_nodes++;
+	}
+
+	return num_nodes;
+}
+
+int dt_match_apply(struct fdt_live_tree *tree,
+		   const struct dt_match_node *nodes, size_t num_nodes)
+{
+	size_t n;
+	int r;
+
+	for (n = 0; n < num_nodes; n++) {
+		switch (nodes[n].match->action) {
+		case DT_MATCH_DELETE:
+			r = fdt_live_del_node(nodes[n].node);
+			break;
+		case DT_MATCH_DISABLE:
+			r = fdt_live_setprop_string(tree, nodes[n].node,
+						    "status", "disabled");
+			break;
+		default:
+			r = -FDT_ERR_INTERNAL;
+			break;
+		}
+		if (r < 0)
+			return r;
+	}
+	return 0;
+}
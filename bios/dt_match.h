@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef DT_MATCH_H
+#define DT_MATCH_H
+
+#include <libfdt.h>
+#include <types_ext.h>
+
+/* Matches a node regardless of the base address in its "reg" property */
+#define DT_MATCH_ANY_BASE	UINT64_MAX
+
+/* Most entries of a table passed to dt_match_find() */
+#define DT_MATCH_TABLE_MAX	16
+
+enum dt_match_action {
+	DT_MATCH_DELETE,	/* Remove the node and its subnodes */
+	DT_MATCH_DISABLE,	/* Set status = "disabled" */
+};
+
+/*
+ * A node matches an entry if one of the strings in its "compatible"
+ * property equals compatible and, unless reg_base is DT_MATCH_ANY_BASE,
+ * the first address in its "reg" property equals reg_base.
+ */
+struct dt_match {
+	const char *compatible;
+	uint64_t reg_base;
+	enum dt_match_action action;
+};
+
+struct dt_match_node {
+	struct fdt_live_node *node;
+	const struct dt_match *match;
+};
+
+/*
+ * Finds the nodes of a live tree matching any of the entries in table in
+ * a single walk of the tree and stores them in nodes, in tree order. A
+ * node matching several entries is stored once, with the first entry it
+ * matches. Returns the number of nodes stored, -FDT_ERR_NOSPACE if more
+ * than max_nodes match.
+ */
+int dt_match_find(const struct fdt_live_tree *tree,
+		  const struct dt_match *table, size_t num_entries,
+		  struct dt_match_node *nodes, size_t max_nodes);
+
+/*
+ * For matching the nodes of a blob while it's walked: the hashes of the
+ * compatible strings of the table are computed once with
+ * dt_match_hash_table(), and dt_match_fdt_node() returns the first entry
+ * the node at nodeoffset matches, or NULL. addr_cells is the
+ * #address-cells of the parent, see fdt_cells_get(). The blob
+ * must have passed fdt_check_full().
+ */
+void dt_match_hash_table(const struct dt_match *table, size_t num_entries,
+			 uint32_t *hashes);
+const struct dt_match *dt_match_fdt_node(const void *fdt, int nodeoffset,
+			int addr_cells, const struct dt_match *table,
+			const uint32_t *hashes, size_t num_entries);
+
+/*
+ * Applies the action of each node found by dt_match_find(). Returns 0 or
+ * a negative libfdt error.
+ */
+int dt_match_apply(struct fdt_live_tree *tree,
+		   const struct dt_match_node *nodes, size_t num_nodes);
+
+#endif /*DT_MATCH_H*/
@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <inttypes.h>
+#include <string.h>
+#include "layout.h"
+#include "msg.h"
+
+/* Round up the even multiple of size, size has to be a multiple of 2 */
+#define ROUNDUP(v, size) (((v) + (size - 1)) & ~(size - 1))
+
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
+#define PAGE_SIZE		0x1000
+
+/* zImage header, see arch/arm/boot/compressed/head.S in Linux */
+#define ZIMAGE_MAGIC_OFFS	0x24
+#define ZIMAGE_MAGIC		0x016f2818
+#define ZIMAGE_EXT_MAGIC_OFFS	0x34
+#define ZIMAGE_EXT_MAGIC	0x45454545
+#define ZIMAGE_TABLE_OFFS	0x38
+#define ZIMAGE_TAG_KRNL_SIZE	0x5a534c4b
+
+/*
+ * The kernel runs at this offset of the base of the memory it uses, its
+ * initial page tables are just below. A zImage decompresses it to a 128
+ * MiB aligned base.
+ */
+#define KERNEL_TEXT_OFFSET	0x8000
+#define ZIMAGE_WINDOW		0x08000000
+/* Above the zImage for its bss, stack and malloc area */
+#define ZIMAGE_SLACK		0x100000
+/*
+ * Room for a kernel of a zImage without size table, what the old fixed
+ * layout left below the zImage or the zImage size times 4, whichever is
+ * larger
+ */
+#define ZIMAGE_RUN_MIN		(0x02000000 - KERNEL_TEXT_OFFSET)
+#define ZIMAGE_RUN_RATIO	4
+
+/*
+ * Any other kernel image is taken as an uncompressed Image, which runs
+ * where it's loaded. Its header doesn't tell the size of the bss, so a
+ * margin is kept free above it for the bss and the early allocations of
+ * the kernel. The base below has to be aligned as the kernel derives
+ * PHYS_OFFSET from it, older kernels require 16 MiB.
+ */
+#define RAW_KERNEL_ALIGN	0x01000000
+#define RAW_KERNEL_MARGIN	0x00800000
+
+/* Room for the ranges of each set the planner works on */
+#define LAYOUT_RANGES_MAX	32
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * The size table of a zImage, newer kernels have it. Each entry is its
+ * length in words, a tag and the values.
+ */
+static bool zimage_size_table(struct layout_kernel *k, const uint8_t *image,
+			      size_t size)
+{
+	uint32_t offs = get_le32(image + ZIMAGE_TABLE_OFFS);
+	uint32_t words;
+	uint32_t piggy_size_offs;
+
+	if (get_le32(image + ZIMAGE_EXT_MAGIC_OFFS) != ZIMAGE_EXT_MAGIC)
+		return false;
+
+	while (offs % 4 == 0 && offs <= size - 4) {
+		words = get_le32(image + offs);
+		if (!words || words > (size - offs) / 4)
+			return false;
+		if (words >= 4 &&
+		    get_le32(image + offs + 4) == ZIMAGE_TAG_KRNL_SIZE) {
+			piggy_size_offs = get_le32(image + offs + 8);
+			if (piggy_size_offs > size - 4)
+				return false;
+			/* Decompressed size and bss size */
+			k->run_size = get_le32(image + piggy_size_offs) +
+				      get_le32(image + offs + 12);
+			if (words >= 5)
+				k->run_offset = get_le32(image + offs + 16);
+			return true;
+		}
+		offs += words * 4;
+	}
+	return false;
+}
+
+void layout_kernel_info(struct layout_kernel *k, const uint8_t *hdr,
+			const uint8_t *image, size_t size)
+{
+	memset(k, 0, sizeof(*k));
+	k->size = size;
+	k->run_offset = KERNEL_TEXT_OFFSET;
+
+	if (size < LAYOUT_KERNEL_HEADER_SIZE ||
+	    get_le32(hdr + ZIMAGE_MAGIC_OFFS) != ZIMAGE_MAGIC) {
+		k->run_size = size + RAW_KERNEL_MARGIN;
+		k->run_estimated = true;
+		return;
+	}
+
+	k->zimage = true;
+	if (image && zimage_size_table(k, image, size))
+		return;
+
+	k->run_size = ZIMAGE_RUN_RATIO * size;
+	if (k->run_size < ZIMAGE_RUN_MIN)
+		k->run_size = ZIMAGE_RUN_MIN;
+	k->run_estimated = true;
+}
+
+/* The lowest aligned start >= min of size free bytes in set */
+static bool find_free(const struct interval_set *set, uint64_t min,
+		      uint64_t size, uint64_t align, uint64_t *start)
+{
+	const struct interval *iv;
+	uint64_t s;
+	size_t n;
+
+	for (n = 0; n < set->num; n++) {
+		iv = set->ivs + n;
+		s = ROUNDUP(iv->start > min ? iv->start : min, align);
+		if (s >= iv->start && s <= iv->end && iv->end - s >= size) {
+			*start = s;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * The decompressed kernel may overwrite busy memory but nothing else,
+ * the zImage goes above it in the same 128 MiB window so it doesn't
+ * have to move itself out of the way first.
+ */
+static bool plan_zimage(const struct interval_set *usable,
+			struct interval_set *avail,
+			const struct layout_kernel *k, struct layout *l)
+{
+	uint64_t base;
+	uint64_t start;
+	size_t n;
+
+	for (n = 0; n < usable->num; n++) {
+		base = usable->ivs[n].start & ~(uint64_t)(ZIMAGE_WINDOW - 1);
+		for (; base < usable->ivs[n].end; base += ZIMAGE_WINDOW) {
+			l->kernel_run = base + k->run_offset;
+			l->kernel_run_end = l->kernel_run + k->run_size;
+			if (!interval_set_covers(usable, l->kernel_run,
+						 l->kernel_run_end))
+				continue;
+			if (!find_free(avail, l->kernel_run_end,
+				       k->size + ZIMAGE_SLACK, PAGE_SIZE,
+				       &start) ||
+			    start >= base + ZIMAGE_WINDOW)
+				continue;
+
+			l->kernel = start;
+			return interval_set_subtract(avail, l->kernel_run,
+						     l->kernel_run_end) &&
+			       interval_set_subtract(avail, start,
+					start + k->size + ZIMAGE_SLACK);
+		}
+	}
+	return false;
+}
+
+/*
+ * An Image is loaded where it runs, the memory below it for the page
+ * tables and above it for the bss may be busy now but not reserved.
+ */
+static bool plan_raw(const struct interval_set *usable,
+		     struct interval_set *avail, const struct layout_kernel *k,
+		     struct layout *l)
+{
+	uint64_t base;
+	size_t n;
+
+	for (n = 0; n < usable->num; n++) {
+		base = ROUNDUP(usable->ivs[n].start, RAW_KERNEL_ALIGN);
+		for (; base < usable->ivs[n].end; base += RAW_KERNEL_ALIGN) {
+			l->kernel = base + k->run_offset;
+			l->kernel_run = l->kernel;
+			l->kernel_run_end = l->kernel + k->run_size;
+			if (!interval_set_covers(usable, base,
+						 l->kernel_run_end) ||
+			    !interval_set_covers(avail, l->kernel,
+						 l->kernel + k->size))
+				continue;
+
+			return interval_set_subtract(avail, base,
+						     l->kernel_run_end);
+		}
+	}
+	return false;
+}
+
+static bool plan_item(struct interval_set *avail, uint64_t min,
+		      uint64_t size, uint64_t align, uint64_t *start)
+{
+	return find_free(avail, min, size, align, start) &&
+	       interval_set_subtract(avail, *start, *start + size);
+}
+
+static void report_set(const char *name, const struct interval_set *set)
+{
+	size_t n;
+
+	msg("%s:\n", name);
+	for (n = 0; n < set->num; n++)
+		msg("  0x%" PRIx64 " .. 0x%" PRIx64 "\n", set->ivs[n].start,
+		    set->ivs[n].end);
+}
+
+static void report_failure(const char *name, uint64_t size,
+			   const struct interval_set *mem,
+			   const struct interval_set *reserved,
+			   const struct interval_set *avail)
+{
+	msg("Can't place %s of size 0x%" PRIx64 "\n", name, size);
+	report_set("Memory", mem);
+	report_set("Reserved", reserved);
+	report_set("Free", avail);
+}
+
+bool layout_plan(const struct interval_set *mem,
+		 const struct interval_set *reserved,
+		 const struct interval_set *busy, const struct layout_kernel *k,
+		 uint64_t dtb_size, uint64_t rootfs_size, struct layout *l)
+{
+	struct interval usable_ivs[LAYOUT_RANGES_MAX];
+	struct interval avail_ivs[LAYOUT_RANGES_MAX];
+	struct interval_set usable;
+	struct interval_set avail;
+	uint64_t min;
+	bool ok;
+
+	interval_set_init(&usable, usable_ivs, ARRAY_SIZE(usable_ivs));
+	interval_set_init(&avail, avail_ivs, ARRAY_SIZE(avail_ivs));
+	if (!interval_set_difference(&usable, mem, reserved) ||
+	    !interval_set_difference(&avail, &usable, busy)) {
+		msg("Too many memory ranges to plan the layout\n");
+		return false;
+	}
+
+	if (k->zimage)
+		ok = plan_zimage(&usable, &avail, k, l);
+	else
+		ok = plan_raw(&usable, &avail, k, l);
+	if (!ok) {
+		msg("%s of size 0x%" PRIx64 " runs in 0x%" PRIx64
+		    " bytes%s\n", k->zimage ? "zImage" : "Image", k->size,
+		    k->run_size, k->run_estimated ? " (estimated)" : "");
+		report_failure("kernel", k->size, mem, reserved, &avail);
+		return false;
+	}
+
+	/* The kernel ignores the memory below where it runs */
+	min = l->kernel_run - k->run_offset;
+	if (!plan_item(&avail, min, dtb_size, PAGE_SIZE, &l->dtb)) {
+		report_failure("DTB", dtb_size, mem, reserved, &avail);
+		return false;
+	}
+	if (!plan_item(&avail, min, rootfs_size, PAGE_SIZE, &l->rootfs)) {
+		report_failure("rootfs", rootfs_size, mem, reserved, &avail);
+		return false;
+	}
+
+	msg("Normal world layout:\n");
+	msg("  kernel 0x%" PRIx64 " .. 0x%" PRIx64 "\n", l->kernel,
+	    l->kernel + k->size);
+	msg("  %s 0x%" PRIx64 " .. 0x%" PRIx64 "%s\n",
+	    k->zimage ? "decompressed kernel" : "kernel and bss",
+	    l->kernel_run, l->kernel_run_end,
+	    k->run_estimated ? " (estimated)" : "");
+	msg("  DTB 0x%" PRIx64 " .. 0x%" PRIx64 "\n", l->dtb,
+	    l->dtb + dtb_size);
+	msg("  rootfs 0x%" PRIx64 " .. 0x%" PRIx64 "\n", l->rootfs,
+	    l->rootfs + rootfs_size);
+	return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <interval_set.h>
+#include <types_ext.h>
+
+/* Bytes of the kernel image layout_kernel_info() looks at */
+#define LAYOUT_KERNEL_HEADER_SIZE	0x3c
+
+/* What the kernel image tells about the memory it needs */
+struct layout_kernel {
+	uint64_t size;
+	bool zimage;
+	/*
+	 * The kernel runs at run_offset above the base of the memory it
+	 * uses, in run_size bytes including its bss. A zImage decompresses
+	 * it to the 128 MiB aligned base it's loaded in, an Image runs where
+	 * it's loaded. The size is estimated for an Image and for a zImage
+	 * without size table.
+	 */
+	uint64_t run_offset;
+	uint64_t run_size;
+	bool run_estimated;
+};
+
+/* Where the normal world images go */
+struct layout {
+	uint64_t kernel;
+	uint64_t kernel_run;
+	uint64_t kernel_run_end;
+	uint64_t dtb;
+	uint64_t rootfs;
+};
+
+/*
+ * Fills in k for a kernel image of size bytes from its first
+ * LAYOUT_KERNEL_HEADER_SIZE bytes at hdr, or fewer if the image is
+ * smaller. image is all of it if it's at hand, for the size table of a
+ * zImage, or NULL.
+ */
+void layout_kernel_info(struct layout_kernel *k, const uint8_t *hdr,
+			const uint8_t *image, size_t size);
+
+/*
+ * Places the kernel, the DTB and the rootfs in the memory banks mem, as
+ * low as they fit. Nothing goes in reserved, and nothing but the running
+ * kernel in busy, all coalesced sets. Reports the layout, or what
+ * doesn't fit and why, and returns false in that case.
+ */
+bool layout_plan(const struct interval_set *mem,
+		 const struct interval_set *reserved,
+		 const struct interval_set *busy, const struct layout_kernel *k,
+		 uint64_t dtb_size, uint64_t rootfs_size, struct layout *l);
+
+#endif /*LAYOUT_H*/
@@ -12,6 +12,11 @@ cleanfiles += $(link-script-pp) $(link-script-dep)
 link-ldflags  = $(LDFLAGS)
 link-ldflags += -T $(link-script-pp) -Map=$(out-dir)bios.map
 
+# Blobs with BIOS_<blob>_LZ4=y are stored as LZ4 frames and decompressed
+# while being loaded
+LZ4		?= lz4
+lz4-cmd		= $(LZ4) -q -f -9 -BD --content-size
+
 link-ldadd  = $(LDADD)
 link-ldadd += $(addprefix -L,$(libdirs))
 link-ldadd += $(addprefix -l,$(libnames))
@@ -27,6 +32,25 @@ blob-objs += $(out-dir)nsec_dtb.o
 cleanfiles += $(out-dir)nsec_dtb.bin
 endif
 
+# The linked DTB is fixed up at build time, with the overlay merged in
+ifdef BIOS_NSEC_DTB
+ifeq ($(BIOS_NSEC_DTB_PREFIXUP),y)
+dtb-prefixup := y
+endif
+endif
+
+ifdef BIOS_NSEC_DTBO
+ifneq ($(dtb-prefixup),y)
+blob-objs += $(out-dir)nsec_dtbo.o
+cleanfiles += $(out-dir)nsec_dtbo.bin
+endif
+endif
+
+ifeq ($(BIOS_VERIFY_IMAGES),y)
+blob-objs += $(out-dir)image_manifest.o
+cleanfiles += $(out-dir)image_manifest.bin
+endif
+
 objs += $(blob-objs)
 cleanfiles += $(blob-objs)
 
@@ -44,10 +68,17 @@ ifndef BIOS_SECURE_BLOB
 $(error BIOS_SECURE_BLOB not defined!)
 endif
 $(out-dir)secure_blob.bin: $(BIOS_SECURE_BLOB) FORCE
+ifeq ($(BIOS_SECURE_BLOB_LZ4),y)
+	@echo '  LZ4     $@'
+	@mkdir -p $(dir $@)
+	@rm -f $@
+	$(q)$(lz4-cmd) $< $@
+else
 	@echo '  LN      $@'
 	@mkdir -p $(dir $@)
 	@rm -f $@
 	$(q)ln -s $(abspath $<) $@
+endif
 
 
 $(out-dir)secure_blob.o: $(out-dir)secure_blob.bin FORCE
@@ -59,29 +90,78 @@ ifndef BIOS_NSEC_BLOB
 $(error BIOS_NSEC_BLOB not defined!)
 endif
 $(out-dir)nsec_blob.bin: $(BIOS_NSEC_BLOB) FORCE
+ifeq ($(BIOS_NSEC_BLOB_LZ4),y)
+	@echo '  LZ4     $@'
+	@mkdir -p $(dir $@)
+	@rm -f $@
+	$(q)$(lz4-cmd) $< $@
+else
 	@echo '  LN      $@'
 	@mkdir -p $(dir $@)
 	@rm -f $@
 	$(q)ln -s $(abspath $<) $@
+endif
 
 $(out-dir)nsec_blob.o: $(out-dir)nsec_blob.bin FORCE
 	@echo '  OBJCOPY $@'
 	$(q)$(OBJCOPY) -I binary -O elf32-littlearm -B arm \
 		--rename-section .data=nsec_blob $< $@
 
-ifdef BIOS_NSEC_DTB
+ifeq ($(dtb-prefixup),y)
+# Host tool applying the same fixups as the BIOS, see bios/dt_fixup.c
+HOSTCC		?= gcc
+dtb-prefixup-bin := $(out-dir)tools/dtb_prefixup
+dtb-prefixup-srcs := bios/tools/dtb_prefixup.c bios/dt_fixup.c \
+		     bios/dt_match.c libutils/ext/interval_set.c \
+		     $(wildcard libfdt/fdt*.c)
+dtb-prefixup-cppflags := \
+	-DPLATFORM_FLAVOR=PLATFORM_FLAVOR_ID_$(PLATFORM_FLAVOR) \
+	$(filter -DTZ_%,$(CPPFLAGS) $(cppflags)) \
+	-Ibios -Ilibfdt/include -Ilibfdt -Ilibutils/ext/include
+cleanfiles += $(dtb-prefixup-bin)
+
+$(dtb-prefixup-bin): $(dtb-prefixup-srcs) $(wildcard bios/*.h libfdt/*.h) \
+		     libutils/ext/include/interval_set.h
+	@echo '  HOSTCC  $@'
+	@mkdir -p $(dir $@)
+	$(q)$(HOSTCC) -O2 $(dtb-prefixup-cppflags) -o $@ $(dtb-prefixup-srcs)
+
+$(out-dir)nsec_dtb.bin: $(BIOS_NSEC_DTB) $(BIOS_NSEC_DTBO) \
+			$(dtb-prefixup-bin) FORCE
+	@echo '  FIXUP   $@'
+	@mkdir -p $(dir $@)
+	@rm -f $@
+	$(q)$(dtb-prefixup-bin) $(BIOS_NSEC_DTB) $@ $(BIOS_NSEC_DTBO)
+else ifdef BIOS_NSEC_DTB
 $(out-dir)nsec_dtb.bin: $(BIOS_NSEC_DTB) FORCE
 	@echo '  LN      $@'
 	@mkdir -p $(dir $@)
 	@rm -f $@
 	$(q)ln -s $(abspath $<) $@
+endif
 
+ifdef BIOS_NSEC_DTB
 $(out-dir)nsec_dtb.o: $(out-dir)nsec_dtb.bin FORCE
 	@echo '  OBJCOPY $@'
 	$(q)$(OBJCOPY) -I binary -O elf32-littlearm -B arm \
 		--rename-section .data=nsec_dtb $< $@
 endif
 
+# A device tree overlay, compiled with dtc -@, merged into the DTB passed
+# to the kernel
+ifdef BIOS_NSEC_DTBO
+$(out-dir)nsec_dtbo.bin: $(BIOS_NSEC_DTBO) FORCE
+	@echo '  LN      $@'
+	@mkdir -p $(dir $@)
+	@rm -f $@
+	$(q)ln -s $(abspath $<) $@
+
+$(out-dir)nsec_dtbo.o: $(out-dir)nsec_dtbo.bin FORCE
+	@echo '  OBJCOPY $@'
+	$(q)$(OBJCOPY) -I binary -O elf32-littlearm -B arm \
+		--rename-section .data=nsec_dtbo $< $@
+endif
+
 ifndef BIOS_NSEC_ROOTFS
 $(error BIOS_NSEC_ROOTFS not defined!)
 else ifeq ($(BIOS_NSEC_ROOTFS),/dev/null)
@@ -92,17 +172,46 @@ $(out-dir)nsec_rootfs.bin: FORCE
 	$(q) echo 'Empty' > $@
 else
 $(out-dir)nsec_rootfs.bin: $(BIOS_NSEC_ROOTFS) FORCE
+ifeq ($(BIOS_NSEC_ROOTFS_LZ4),y)
+	@echo '  LZ4     $@'
+	@mkdir -p $(dir $@)
+	@rm -f $@
+	$(q)$(lz4-cmd) $< $@
+else
 	@echo '  LN      $@'
 	@mkdir -p $(dir $@)
 	@rm -f $@
 	$(q)ln -s $(abspath $<) $@
 endif
+endif
 
 $(out-dir)nsec_rootfs.o: $(out-dir)nsec_rootfs.bin FORCE
 	@echo '  OBJCOPY $@'
 	$(q)$(OBJCOPY) -I binary -O elf32-littlearm -B arm \
 		--rename-section .data=nsec_rootfs $< $@
 
+# The manifest is the sha256sum output for the images as loaded, that is
+# for the original files and not the LZ4 frames, listed in the order of
+# enum manifest_entry in bios/main.c
+ifeq ($(BIOS_VERIFY_IMAGES),y)
+ifeq ($(BIOS_NSEC_ROOTFS),/dev/null)
+manifest-rootfs := $(out-dir)nsec_rootfs.bin
+else
+manifest-rootfs := $(BIOS_NSEC_ROOTFS)
+endif
+manifest-srcs := $(BIOS_SECURE_BLOB) $(BIOS_NSEC_BLOB) $(manifest-rootfs)
+
+$(out-dir)image_manifest.bin: $(manifest-srcs) FORCE
+	@echo '  GEN     $@'
+	@mkdir -p $(dir $@)
+	$(q)sha256sum $(manifest-srcs) > $@
+
+$(out-dir)image_manifest.o: $(out-dir)image_manifest.bin FORCE
+	@echo '  OBJCOPY $@'
+	$(q)$(OBJCOPY) -I binary -O elf32-littlearm -B arm \
+		--rename-section .data=image_manifest $< $@
+endif
+
 $(link-script-pp): $(link-script)
 	@echo '  CPP     $@'
 	@mkdir -p $(dir $@)
@@ -27,13 +27,25 @@
 
 #include "platform_config.h"
 
+#include <arm32.h>
 #include <compiler.h>
 #include <types_ext.h>
 #include <inttypes.h>
 #include <string.h>
 #include <stdio.h>
 #include <libfdt.h>
+#include <lz4.h>
+#include <sha256.h>
+#include <string_ext.h>
 #include <drivers/uart.h>
+#include "boot_info.h"
+#include "boot_time.h"
+#include "dt_fixup.h"
+#include "layout.h"
+#include "mmu.h"
+#include "msg.h"
+#include "pmu.h"
+#include "smp.h"
 
 #ifndef MAX
 #define MAX(a, b) \
@@ -48,36 +60,61 @@
 #endif
 
 
+#define ARRAY_SIZE(a)	(sizeof(a) / sizeof((a)[0]))
+
 /* Round up the even multiple of size, size has to be a multiple of 2 */
 #define ROUNDUP(v, size) (((v) + (size - 1)) & ~(size - 1))
 
 #define PAGE_SIZE	4096
 
+#define MAX_HANDOFF_RANGES	16
+
+/* Room for the memory and reserved ranges the layout is planned in */
+#define LAYOUT_MEM_RANGES	16
+
 static uint32_t kernel_entry;
 static uint32_t dtb_addr;
 static uint32_t rootfs_start;
 static uint32_t rootfs_end;
+static int secure_world_phase = -1;
+static int kernel_phase = -1;
 
 extern const uint8_t __text_start;
+extern const uint8_t __data_end;
+extern const uint8_t __bss_start;
+extern const uint8_t __bss_end;
 extern const uint8_t __linker_secure_blob_start;
 extern const uint8_t __linker_secure_blob_end;
 extern const uint8_t __linker_nsec_blob_start;
 extern const uint8_t __linker_nsec_blob_end;
 extern const uint8_t __linker_nsec_dtb_start;
 extern const uint8_t __linker_nsec_dtb_end;
+extern const uint8_t __linker_nsec_dtbo_start;
+extern const uint8_t __linker_nsec_dtbo_end;
 extern const uint8_t __linker_nsec_rootfs_start;
 extern const uint8_t __linker_nsec_rootfs_end;
+extern const uint8_t __linker_image_manifest_start;
+extern const uint8_t __linker_image_manifest_end;
+
+/* Memory written by the BIOS outside of its own RAM, to clean at handoff */
+static struct {
+	uint32_t start;
+	uint32_t end;
+} handoff_ranges[MAX_HANDOFF_RANGES];
+static size_t num_handoff_ranges;
 
 static uint32_t main_stack[4098]
 	__attribute__((section(".bss.prebss.stack"), aligned(8)));
 
 const uint32_t main_stack_top = (uint32_t)main_stack + sizeof(main_stack);
 
-#define CHECK(x) \
-	do { \
-		if ((x)) \
-			check(#x, __FILE__, __LINE__); \
-	} while (0)
+/* Cycles spent relocating the BIOS and clearing bss, saved by reset */
+uint32_t boot_reloc_cycles;
+uint32_t boot_bss_cycles;
+
+/* Implemented in entry.S */
+void boot_copy(const void *src, void *dst, size_t len);
+void boot_copy_bytewise(const void *src, void *dst, size_t len);
 
 #ifdef CONSOLE_UART_BASE
 static void msg_init(void)
@@ -85,7 +122,7 @@ static void msg_init(void)
 	uart_init(CONSOLE_UART_BASE);
 }
 
-static void __printf(1, 2) msg(const char *fmt, ...)
+void msg(const char *fmt, ...)
 {
 	va_list ap;
 	char buf[128];
@@ -106,12 +143,12 @@ static void msg_init(void)
 {
 }
 
-static void __printf(1, 2) msg(const char *fmt __unused, ...)
+void msg(const char *fmt __unused, ...)
 {
 }
 #endif
 
-static void check(const char *expr, const char *file, int line)
+void check(const char *expr, const char *file, int line)
 {
 	msg("Check \"%s\": %s:%d\n", expr, file, line);
 	while (true);
@@ -122,522 +159,688 @@ static const void *unreloc(const void *addr)
 	return (void *)((uint32_t)addr - (uint32_t)&__text_start);
 }
 
-static uint32_t copy_bios_image(const char *name, uint32_t dst,
-		const uint8_t *start, const uint8_t *end)
+static void report_boot_copy(void)
 {
-	size_t l = (size_t)(end - start);
+	size_t reloc_len = &__data_end - &__text_start;
+	size_t bss_len = &__bss_end - &__bss_start;
+	size_t l = MIN(reloc_len, (size_t)BIOS_SCRATCH_SIZE);
+	uint32_t burst;
+	uint32_t bytewise;
+	uint32_t t;
+
+	msg("Relocated %#zx bytes in %" PRIu32 " cycles\n",
+		reloc_len, boot_reloc_cycles);
+	msg("Cleared %#zx bytes of bss in %" PRIu32 " cycles\n",
+		bss_len, boot_bss_cycles);
 
-	msg("Copy image \"%s\" size %#zx, from %p to %p\n",
-		name, l, unreloc(start), (void *)dst);
+	/*
+	 * Copy the start of the BIOS once more to scratch memory, with
+	 * both the burst copy and the old byte copy, to see the gain.
+	 */
+	t = read_pmccntr();
+	boot_copy(unreloc(&__text_start), (void *)BIOS_SCRATCH_START, l);
+	burst = read_pmccntr() - t;
 
-	memcpy((void *)dst, unreloc(start), l);
-	return dst + l;
+	t = read_pmccntr();
+	boot_copy_bytewise(unreloc(&__text_start), (void *)BIOS_SCRATCH_START,
+			   l);
+	bytewise = read_pmccntr() - t;
+
+	msg("Copy of %#zx bytes: %" PRIu32 " cycles, bytewise %" PRIu32
+		" cycles\n", l, burst, bytewise);
 }
 
-static void *open_fdt(uint32_t dst, const uint8_t *start, const uint8_t *end)
+static void add_handoff_range(uint32_t start, uint32_t end)
 {
-	int r;
-	const void *s;
-
-	if (start != end) {
-		msg("Using hardcoded DTB\n");
-		CHECK((size_t)(end - start) > DTB_MAX_SIZE);
-		s = unreloc(start);
-		msg("Copy dtb from %p to %p\n", s, (void *)dst);
-	} else {
-		s = (void *)dst;
-		msg("Using QEMU provided DTB at %p\n", s);
-	}
-
-	r = fdt_open_into(s, (void *)dst, DTB_MAX_SIZE);
-	CHECK(r < 0);
-
-	return (void *)dst;
+	CHECK(num_handoff_ranges >= MAX_HANDOFF_RANGES);
+	handoff_ranges[num_handoff_ranges].start = start;
+	handoff_ranges[num_handoff_ranges].end = end;
+	num_handoff_ranges++;
 }
 
-static size_t get_cells_size(void *fdt, int offs, const char *cell_name)
+/*
+ * Writes everything loaded so far back to memory before the secure world
+ * is entered with the MMU and caches off.
+ */
+static void clean_handoff_ranges(void)
 {
-	int len;
-	const uint32_t *cell = fdt_getprop(fdt, offs, cell_name, &len);
-	size_t cells_size;
-
-	CHECK(len != sizeof(uint32_t));
+	size_t n;
 
-	cells_size = fdt32_to_cpu(*cell);
+	for (n = 0; n < num_handoff_ranges; n++)
+		cache_clean_inv_range(handoff_ranges[n].start,
+				      handoff_ranges[n].end -
+				      handoff_ranges[n].start);
+}
 
-	CHECK(cells_size != 1 && cells_size != 2);
+/*
+ * The image manifest is the sha256sum output for the images, generated at
+ * build time. It's absent if image verification is disabled. The digests
+ * verified are passed on in the boot information.
+ */
+enum manifest_entry {
+	MANIFEST_SECURE_BLOB = BOOT_INFO_IMAGE_SECURE,
+	MANIFEST_NSEC_BLOB = BOOT_INFO_IMAGE_KERNEL,
+	MANIFEST_NSEC_ROOTFS = BOOT_INFO_IMAGE_ROOTFS,
+};
 
-	return cells_size;
+static int hex_nibble(uint8_t c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
 }
 
-static uint64_t get_val(const void *prop, size_t *offs, size_t cell_size)
+static bool manifest_digest(enum manifest_entry entry,
+		uint8_t digest[SHA256_DIGEST_SIZE])
 {
-	const void *addr = (const char *)prop + *offs;
+	const uint8_t *p = unreloc(&__linker_image_manifest_start);
+	const uint8_t *end = unreloc(&__linker_image_manifest_end);
+	unsigned int n;
+	int hi;
+	int lo;
 
-	*offs += cell_size * sizeof(uint32_t);
-
-	if (cell_size == 1) {
-		uint32_t v;
+	if (p == end)
+		return false;
 
-		memcpy(&v, addr, sizeof(v));
-		return fdt32_to_cpu(v);
-	} else {
-		uint64_t v;
+	/* Skip to the line of the entry */
+	for (n = 0; n < entry; n++) {
+		while (p < end && *p != '\n')
+			p++;
+		CHECK(p == end);
+		p++;
+	}
 
-		memcpy(&v, addr, sizeof(v));
-		return fdt64_to_cpu(v);
+	CHECK((size_t)(end - p) < SHA256_DIGEST_SIZE * 2);
+	for (n = 0; n < SHA256_DIGEST_SIZE; n++) {
+		hi = hex_nibble(p[n * 2]);
+		lo = hex_nibble(p[n * 2 + 1]);
+		CHECK(hi < 0 || lo < 0);
+		digest[n] = (hi << 4) | lo;
 	}
+	return true;
 }
 
-static void put_val(void *prop, size_t *offs, size_t cell_size,
-		uint64_t val)
+/* An image linked into the blobs section, raw or LZ4 compressed */
+struct bios_image {
+	const uint8_t *pos;
+	const uint8_t *end;
+	size_t size;
+	size_t offs;
+	bool compressed;
+	struct lz4_stream lz4;
+	bool verify;
+	enum manifest_entry entry;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	struct sha256_ctx sha256;
+};
+
+static void open_bios_image(struct bios_image *img, const uint8_t *start,
+		const uint8_t *end, enum manifest_entry entry)
 {
-	void *addr = (char *)prop + *offs;
+	img->pos = unreloc(start);
+	img->end = unreloc(end);
+	img->offs = 0;
+	img->compressed = lz4_is_frame(img->pos, img->end - img->pos);
+	if (img->compressed) {
+		CHECK(lz4_stream_init(&img->lz4, img->pos,
+				      img->end - img->pos));
+		/* Compressed images are built with the size in the header */
+		img->size = lz4_stream_content_size(&img->lz4);
+		CHECK(!img->size);
+	} else {
+		img->size = img->end - img->pos;
+	}
 
-	*offs += cell_size * sizeof(uint32_t);
+	img->entry = entry;
+	img->verify = manifest_digest(entry, img->digest);
+	if (img->verify)
+		sha256_init(&img->sha256);
+}
 
-	if (cell_size == 1) {
-		uint32_t v = cpu_to_fdt32((uint32_t)val);
+/* Size of what's left of the image once decompressed */
+static size_t bios_image_size(struct bios_image *img)
+{
+	return img->size - img->offs;
+}
 
-		memcpy(addr, &v, sizeof(v));
-	} else {
-		uint64_t v = cpu_to_fdt64((uint32_t)val);
+static void verify_bios_image(const char *name, struct bios_image *img)
+{
+	uint8_t digest[SHA256_DIGEST_SIZE];
 
-		memcpy(addr, &v, sizeof(v));
+	sha256_final(&img->sha256, digest);
+	if (buf_compare_ct(digest, img->digest, sizeof(digest))) {
+		msg("Image \"%s\" doesn't match the manifest digest\n", name);
+		CHECK(1);
 	}
+	msg("Image \"%s\" verified\n", name);
+	boot_info_set_image_hash((enum boot_info_image)img->entry, digest);
 }
 
-static void tz_res_mem_check_avail(const void *prop, size_t plen,
-			size_t addr_size, size_t len_size)
+/* Moves past the l bytes just read, verifies the image once all read */
+static void advance_bios_image(const char *name, struct bios_image *img,
+		size_t l)
 {
-	uint64_t res_start = TZ_RES_MEM_START;
-	uint64_t res_end = res_start + TZ_RES_MEM_SIZE;
-	uint64_t last_res_start;
-	uint64_t last_res_end;
-	size_t offs;
-	uint64_t start;
-	uint64_t len;
-	uint64_t end;
-
-	msg("Checking that secure memory is available\n");
-	msg("0x%" PRIx64 " .. 0x%" PRIx64 "\n", res_start, res_end);
-	msg("Available memory\n");
-	for (offs = 0; offs < plen;) {
-		start = get_val(prop, &offs, addr_size);
-		len = get_val(prop, &offs, len_size);
-		end = start + len;
-		msg("0x%" PRIx64 " .. 0x%" PRIx64 "\n", start, end);
-	}
+	if (!img->compressed)
+		img->pos += l;
+	img->offs += l;
 
-	do {
-		last_res_start = res_start;
-		last_res_end = res_end;
-		offs = 0;
-		while (offs < plen && res_start != res_end) {
-			start = get_val(prop, &offs, addr_size);
-			len = get_val(prop, &offs, len_size);
-			end = start + len;
-
-			if (start <= res_start && end >= res_end)
-				goto mem_avail;
-
-			if (start <= res_start && end > res_start) {
-				/*
-				 * Found beginning of reserved memory in
-				 * this memory block.
-				 */
-				res_start = MIN(end, res_end);
-			} else if (end >= res_end && start < res_end) {
-				/*
-				 * Found end of of reserved memory in
-				 * this memory block.
-				 */
-				res_end = MAX(start, res_start);
-			}
-
-			/*
-			 * Here either the current memory block doesn't
-			 * cover the reserved memroy at all or we would
-			 * need to split the reserved memroy region for
-			 * book keeping. Instead we're looping through all
-			 * memory blocks trying to find of start and end of
-			 * reserved memory until everything is accounted
-			 * for. That means that we may need to loop over
-			 * the memory blocks several times.
-			 */
+	if (img->verify && !bios_image_size(img))
+		verify_bios_image(name, img);
+}
 
+/*
+ * Reads the next l bytes of the image into buf, decompressed and hashed
+ * as they're read. For small reads into the BIOS's own memory, such as
+ * headers on the stack: no boot phase, no handoff range, no smp_copy().
+ * When the image is verified each chunk is hashed right after being
+ * written, while it's still in the cache.
+ */
+static void read_bios_image(const char *name, void *buf,
+		struct bios_image *img, size_t l)
+{
+	uint8_t *d = buf;
+	size_t left = l;
+	size_t n;
+
+	CHECK(l > bios_image_size(img));
+	if (!img->compressed) {
+		if (img->verify)
+			sha256_copy(&img->sha256, d, img->pos, l);
+		else
+			memcpy(d, img->pos, l);
+	} else if (!img->verify) {
+		CHECK(lz4_stream_read(&img->lz4, d, l) != (ssize_t)l);
+	} else {
+		while (left) {
+			n = MIN(left, (size_t)SHA256_COPY_CHUNK_SIZE);
+			CHECK(lz4_stream_read(&img->lz4, d, n) != (ssize_t)n);
+			sha256_update(&img->sha256, d, n);
+			d += n;
+			left -= n;
 		}
-
-		if (res_start == res_end)
-			goto mem_avail;
-
-		/*
-		 * Loop through the memory list until there's no changes in
-		 * the amount of reserved memory accounted for.
-		 */
-	} while (last_res_start != res_start || last_res_end != res_end);
-
-	msg("Can't find secure memory\n");
-	msg("0x%" PRIx64 " .. 0x%" PRIx64 "\n", res_start, res_end);
-	CHECK(1);
-
-mem_avail:
-	msg("Secure memory is available\n");
+	}
+	advance_bios_image(name, img, l);
 }
 
-static void tz_res_mem_carve(const void *prop, size_t plen,
-			size_t addr_size, size_t len_size,
-			void *data, size_t *dlen)
+/*
+ * Copies the next l bytes of the image to dst, its final location, as a
+ * boot phase. The range is cleaned to memory at handoff.
+ */
+static uint32_t copy_bios_image(const char *name, uint32_t dst,
+		struct bios_image *img, size_t l)
 {
-	const uint64_t tz_res_end = (uint64_t)TZ_RES_MEM_START +
-				    TZ_RES_MEM_SIZE;
-	size_t poffs;
-	size_t doffs;
-	uint64_t start;
-	uint64_t len;
-	uint64_t end;
-
-	poffs = 0;
-	msg("Original DTB memory: start len\n");
-	while (poffs < plen) {
-		start = get_val(prop, &poffs, addr_size);
-		len = get_val(prop, &poffs, len_size);
-
-		msg("0x%" PRIx64 " 0x%" PRIx64 "\n", start, len);
+	void *d = (void *)dst;
+	int phase = boot_phase_begin(name);
+
+	msg("Copy image \"%s\" size %#zx, from %p to %p%s\n",
+		name, l, img->pos, d, img->compressed ? " (lz4)" : "");
+
+	CHECK(l > bios_image_size(img));
+	if (img->compressed) {
+		read_bios_image(name, d, img, l);
+	} else if (!img->verify) {
+		smp_copy(d, img->pos, l);
+		advance_bios_image(name, img, l);
+	} else if (smp_copy_start(d, img->pos, l)) {
+		/* Hash the source while the secondary cores copy */
+		sha256_update(&img->sha256, img->pos, l);
+		smp_copy_wait();
+		advance_bios_image(name, img, l);
+	} else {
+		read_bios_image(name, d, img, l);
 	}
 
-	poffs = 0;
-	doffs = 0;
-	while (poffs < plen) {
-		start = get_val(prop, &poffs, addr_size);
-		len = get_val(prop, &poffs, len_size);
-		end = start + len;
-
-		if (TZ_RES_MEM_START == start && TZ_RES_MEM_SIZE == len) {
-			/*
-			 * Remove a region
-			 */
-
-		} else if (TZ_RES_MEM_START > start && tz_res_end < end) {
-			/*
-			 * Split a region
-			 */
-			put_val(data, &doffs, addr_size, start);
-			put_val(data, &doffs, len_size,
-					TZ_RES_MEM_START - start);
-
-			put_val(data, &doffs, addr_size, tz_res_end);
-			put_val(data, &doffs, len_size, end - tz_res_end);
-
-		} else if (TZ_RES_MEM_START > start && TZ_RES_MEM_START < end) {
-			/*
-			 * Chop of the end of a region.
-			 */
-			put_val(data, &doffs, addr_size, start);
-			put_val(data, &doffs, len_size,
-					TZ_RES_MEM_START - start);
-		} else if (tz_res_end < end) {
-			/*
-			 * Chop of the begining of a region.
-			 */
-			put_val(data, &doffs, addr_size, tz_res_end);
-			put_val(data, &doffs, len_size, end - tz_res_end);
-		}
-	}
-	CHECK(doffs > *dlen);
-	*dlen = doffs;
+	add_handoff_range(dst, dst + l);
+	boot_phase_end(phase);
+	return dst + l;
+}
 
-	doffs = 0;
-	msg("Carved out TZ memory from DTB memory: start len\n");
-	while (doffs < *dlen) {
-		start = get_val(data, &doffs, addr_size);
-		len = get_val(data, &doffs, len_size);
+/*
+ * The linked DTB, or the one QEMU provides at DTB_START. Either is
+ * checked in full once, the fixups read it unchecked after that.
+ */
+static const void *kernel_dtb_source(const uint8_t *start, const uint8_t *end)
+{
+	const void *s;
+	size_t size;
+	int r;
 
-		msg("0x%" PRIx64 " 0x%" PRIx64 "\n", start, len);
+	if (start != end) {
+		msg("Using hardcoded DTB\n");
+		size = end - start;
+		CHECK(size > DTB_MAX_SIZE);
+		s = unreloc(start);
+	} else {
+		s = (void *)DTB_START;
+		size = DTB_MAX_SIZE;
+		msg("Using QEMU provided DTB at %p\n", s);
 	}
+
+	r = fdt_check_full(s, size);
+	if (r < 0)
+		msg("Bad DTB: %s\n", fdt_strerror(r));
+	CHECK(r < 0);
+	return s;
 }
 
-static void tz_res_mem(void *fdt)
+/*
+ * Unflattens the source DTB into a live tree in scratch memory. The blob
+ * itself is left as is, it's read until the tree is flattened at its
+ * final location for the kernel.
+ */
+static void open_fdt(struct fdt_live_tree *tree, const void *s)
 {
-	int offs;
-	const void *prop;
-	int len;
 	int r;
-	size_t addr_size;
-	size_t len_size;
 
-	offs = fdt_subnode_offset(fdt, 0, "memory");
-	CHECK(offs < 0);
+	r = fdt_live_unflatten(s, tree, (void *)BIOS_SCRATCH_START,
+			       BIOS_SCRATCH_SIZE);
+	CHECK(r < 0);
+}
 
-	prop = fdt_getprop(fdt, offs, "reg", &len);
-	CHECK(!prop);
+/*
+ * Plans where the normal world images go in the memory of the source
+ * DTB, around the secure memory and the BIOS. The DTB is written by
+ * setup_kernel_dtb() later on, it gets room for the largest it can be.
+ */
+static void plan_ns_layout(const void *dtb, const struct layout_kernel *k,
+			   uint64_t rootfs_size, struct layout *l)
+{
+	struct interval mem_ivs[LAYOUT_MEM_RANGES];
+	struct interval reserved_ivs[LAYOUT_MEM_RANGES];
+	struct interval busy_ivs[1];
+	struct interval_set mem;
+	struct interval_set reserved;
+	struct interval_set busy;
+	bool ok;
+
+	interval_set_init(&mem, mem_ivs, ARRAY_SIZE(mem_ivs));
+	interval_set_init(&reserved, reserved_ivs, ARRAY_SIZE(reserved_ivs));
+	interval_set_init(&busy, busy_ivs, ARRAY_SIZE(busy_ivs));
+
+	/* The BIOS only reaches the first 4 GiB */
+	ok = dt_fixup_fdt_mem_map(dtb, &mem, &reserved) &&
+	     interval_set_insert(&reserved, 1ULL << 32, UINT64_MAX) &&
+	     interval_set_insert(&busy, DTB_START,
+				 ROUNDUP((uint32_t)&__bss_end, PAGE_SIZE));
+	CHECK(!ok);
+
+	ok = layout_plan(&mem, &reserved, &busy, k, DTB_MAX_SIZE,
+			 rootfs_size, l);
+	CHECK(!ok);
+}
 
-	addr_size = get_cells_size(fdt, 0, "#address-cells");
-	len_size = get_cells_size(fdt, 0, "#size-cells");
+static void copy_ns_images(const void *dtb)
+{
+	struct bios_image kernel;
+	struct bios_image rootfs;
+	uint8_t hdr[LAYOUT_KERNEL_HEADER_SIZE];
+	const uint8_t *image = NULL;
+	struct layout_kernel k;
+	struct layout l;
+	size_t hdr_size;
+
+	open_bios_image(&kernel, &__linker_nsec_blob_start,
+			&__linker_nsec_blob_end, MANIFEST_NSEC_BLOB);
+	open_bios_image(&rootfs, &__linker_nsec_rootfs_start,
+			&__linker_nsec_rootfs_end, MANIFEST_NSEC_ROOTFS);
 
-	tz_res_mem_check_avail(prop, len, addr_size, len_size);
+	/*
+	 * The header tells how much room the kernel needs once running, a
+	 * raw image can also be searched for the zImage size table.
+	 */
+	if (!kernel.compressed)
+		image = kernel.pos;
+	hdr_size = MIN(sizeof(hdr), bios_image_size(&kernel));
+	read_bios_image("kernel", hdr, &kernel, hdr_size);
+	layout_kernel_info(&k, hdr, image, hdr_size + bios_image_size(&kernel));
+
+	plan_ns_layout(dtb, &k, bios_image_size(&rootfs), &l);
+	kernel_entry = l.kernel;
+	dtb_addr = l.dtb;
+	rootfs_start = l.rootfs;
+
+	/* Copy non-secure images in place */
+	memcpy((void *)kernel_entry, hdr, hdr_size);
+	add_handoff_range(kernel_entry, kernel_entry + hdr_size);
+	copy_bios_image("kernel", kernel_entry + hdr_size, &kernel,
+			bios_image_size(&kernel));
+	rootfs_end = copy_bios_image("rootfs", rootfs_start, &rootfs,
+				     bios_image_size(&rootfs));
+}
 
-	{
-		uint8_t data[len + (addr_size + len_size) * sizeof(uint32_t)];
-		size_t dlen = sizeof(data);
+#define OPTEE_MAGIC		0x4554504f
+#define OPTEE_VERSION		1
+#define OPTEE_ARCH_ARM32	0
+#define OPTEE_ARCH_ARM64	1
 
-		tz_res_mem_carve(prop, len, addr_size, len_size, data, &dlen);
 
-		r = fdt_setprop(fdt, offs, "reg", data, dlen);
-		CHECK(r < 0);
-	}
-}
+struct optee_header {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t arch;
+	uint16_t flags;
+	uint32_t init_size;
+	uint32_t init_load_addr_hi;
+	uint32_t init_load_addr_lo;
+	uint32_t init_mem_usage;
+	uint32_t paged_size;
+};
 
 
-#ifdef TZ_UART_SHARED
-static void tz_res_uart(void *fdt __unused)
-{
-	msg("Uart shared between secure and non-secure world\n");
-}
-#else
+/* Loaded into r0-r5 by entry.S, see there for what OP-TEE gets */
+struct sec_entry_arg {
+	uint32_t entry;
+	uint32_t paged_part;
+	uint32_t fdt;
+	uint32_t shm;
+	uint32_t shm_size;
+	uint32_t boot_info;
+};
 
-static bool node_is_compatible(void *fdt, int offs, const char *compat)
+/* Merges the deployment's overlay, if one is linked in, into the tree */
+static void apply_dtbo(struct fdt_live_tree *tree, const uint8_t *start,
+		       const uint8_t *end)
 {
-	int plen;
-	const char *prop;
+	int phase;
+	int r;
 
-	prop = fdt_getprop(fdt, offs, "compatible", &plen);
-	if (!prop)
-		return false;
+	if (start == end)
+		return;
 
-	while (plen > 0) {
-		size_t l;
+	msg("Applying DTB overlay\n");
+	phase = boot_phase_begin("apply_dtbo");
+	r = fdt_live_overlay_apply(tree, unreloc(start));
+	boot_phase_end(phase);
+	if (r < 0)
+		msg("DTB overlay: %s\n", fdt_strerror(r));
+	CHECK(r < 0);
+}
 
-		if (strcmp(prop, compat) == 0)
-			return true;
+static void setprop_cell(struct fdt_live_tree *tree, const char *node_path,
+		const char *property, uint32_t val)
+{
+	struct fdt_live_node *node;
+	int r;
 
-		l = strlen(prop) + 1;
-		prop += l;
-		plen -= l;
-	}
+	node = fdt_live_path(tree, node_path);
+	CHECK(!node);
 
-	return false;
+	r = fdt_live_setprop_u32(tree, node, property, val);
+	CHECK(r < 0);
 }
 
-static bool has_reg_base(void *fdt, int offs, size_t addr_size,
-			uintptr_t base)
+static void setprop_string(struct fdt_live_tree *tree, const char *node_path,
+		const char *property, const char *string)
 {
-	int plen;
-	size_t poffs = 0;
-	const void *prop;
-	uintptr_t prop_base;
+	struct fdt_live_node *node;
+	int r;
 
-	prop = fdt_getprop(fdt, offs, "reg", &plen);
-	if (!prop)
-		return false;
+	node = fdt_live_path(tree, node_path);
+	CHECK(!node);
 
-	prop_base = get_val(prop, &poffs, addr_size);
-	return prop_base == base;
+	r = fdt_live_setprop_string(tree, node, property, string);
+	CHECK(r < 0);
 }
 
-static void tz_res_uart(void *fdt)
+/*
+ * Unflattens the DTB and applies all fixups to the live tree, the secure
+ * ones, the overlay as well as /chosen, before flattening it once at
+ * fdt. Only used when there's an overlay to apply at boot.
+ */
+static void build_kernel_dtb_live(const void *src, void *fdt)
 {
+	struct fdt_live_tree tree;
+	struct fdt_live_node *chosen;
+	int phase;
 	int r;
-	int offs = 0;
-	const char *name;
-	size_t addr_size;
-
-	addr_size = get_cells_size(fdt, 0, "#address-cells");
-
-	while (true) {
-		offs = fdt_next_node(fdt, offs, NULL);
-		if (offs < 0)
-			break;
-		name = fdt_get_name(fdt, offs, NULL);
-		if (!node_is_compatible(fdt, offs, "arm,pl011"))
-			continue;
-		if (!has_reg_base(fdt, offs, addr_size, UART1_BASE))
-			continue;
-		msg("Removing node \"%s\" from DTB passed to kernel\n", name);
-		r = fdt_del_node(fdt, offs);
-		CHECK(r < 0);
-		break;
-	}
+
+	phase = boot_phase_begin("open_fdt");
+	open_fdt(&tree, src);
+	boot_phase_end(phase);
+
+	phase = boot_phase_begin("tz_res_mem");
+	dt_fixup_tz_res_mem(&tree);
+	boot_phase_end(phase);
+	dt_fixup_tz_res_uart(&tree);
+	dt_fixup_optee_node(&tree);
+	apply_dtbo(&tree, &__linker_nsec_dtbo_start, &__linker_nsec_dtbo_end);
+
+	setprop_cell(&tree, "/chosen", "linux,initrd-start", rootfs_start);
+	setprop_cell(&tree, "/chosen", "linux,initrd-end", rootfs_end);
+	setprop_string(&tree, "/chosen", "bootargs", COMMAND_LINE);
+
+	/* Phases yet to come are added now and restarted when they begin */
+	secure_world_phase = boot_phase_begin("secure world");
+	kernel_phase = boot_phase_begin("call_kernel");
+
+	chosen = fdt_live_path(&tree, "/chosen");
+	CHECK(!chosen);
+	r = boot_time_add_fdt(&tree, chosen);
+	CHECK(r < 0);
+
+	msg("Flatten dtb to %p\n", fdt);
+	r = fdt_live_flatten(&tree, fdt, DTB_MAX_SIZE);
+	CHECK(r < 0);
 }
-#endif
 
-static void tz_add_optee_node(void *fdt)
+/* Properties of /chosen set by the BIOS, any in the source are dropped */
+static int chosen_property(void *arg __unused, void *out __unused,
+		const void *fdt __unused, int offs __unused, const char *name,
+		const void *val __unused, int len __unused)
 {
-	int offs;
-	int ret;
-
-	offs = fdt_path_offset(fdt, "/");
-	CHECK(offs < 0);
-	offs = fdt_add_subnode(fdt, offs, "firmware");
-	CHECK(offs < 0);
-	offs = fdt_add_subnode(fdt, offs, "optee");
-	CHECK(offs < 0);
-	ret = fdt_setprop_string(fdt, offs, "compatible", "linaro,optee-tz");
-	CHECK(ret < 0);
-	ret = fdt_setprop_string(fdt, offs, "method", "smc");
-	CHECK(ret < 0);
+	static const char * const props[] = {
+		"linux,initrd-start", "linux,initrd-end", "bootargs",
+		"bios,timer-frequency", "bios,boot-phases", "bios,boot-times",
+	};
+	size_t n;
+
+	for (n = 0; n < ARRAY_SIZE(props); n++)
+		if (!strcmp(name, props[n]))
+			return FDT_STREAM_SKIP;
+	return 0;
 }
 
-static uint32_t copy_dtb(uint32_t dst, uint32_t src)
+static int chosen_end_props(void *arg __unused, void *out,
+		const void *fdt __unused, int offs __unused)
 {
 	int r;
 
-	msg("Relocating DTB for kernel use at %p\n", (void *)dst);
-	r = fdt_open_into((void *)src, (void *)dst, DTB_MAX_SIZE);
-	CHECK(r < 0);
-	return dst + DTB_MAX_SIZE;
+	r = fdt_property_u32(out, "linux,initrd-start", rootfs_start);
+	if (r < 0)
+		return r;
+	r = fdt_property_u32(out, "linux,initrd-end", rootfs_end);
+	if (r < 0)
+		return r;
+	r = fdt_property_string(out, "bootargs", COMMAND_LINE);
+	if (r < 0)
+		return r;
+	return boot_time_add_fdt_sw(out);
 }
 
-static void copy_ns_images(void)
-{
-	uint32_t dst;
+static const struct fdt_stream_ops chosen_ops = {
+	.property = chosen_property,
+	.end_props = chosen_end_props,
+};
 
-	/* 32MiB above beginning of RAM */
-	kernel_entry = DRAM_START + 32 * 1024 * 1024;
+/*
+ * Writes the kernel DTB at fdt in one pass over the source DTB, with the
+ * fixups and /chosen applied to each node on the way. Nothing but the
+ * output is written, its size is exactly what the nodes take.
+ */
+static void build_kernel_dtb(const void *src, void *fdt)
+{
+	int phase;
+	int r;
 
-	/* Copy non-secure image in place */
-	dst = copy_bios_image("kernel", kernel_entry, &__linker_nsec_blob_start,
-			&__linker_nsec_blob_end);
+	phase = boot_phase_begin("build_dtb");
 
-	dtb_addr = ROUNDUP(dst, PAGE_SIZE) + 96 * 1024 * 1024; /* safe spot */
-	dst = copy_dtb(dtb_addr, DTB_START);
+	/* Phases yet to come are added now and restarted when they begin */
+	secure_world_phase = boot_phase_begin("secure world");
+	kernel_phase = boot_phase_begin("call_kernel");
 
-	rootfs_start = ROUNDUP(dst + DTB_MAX_SIZE, PAGE_SIZE);
-	rootfs_end = copy_bios_image("rootfs", rootfs_start,
-			&__linker_nsec_rootfs_start, &__linker_nsec_rootfs_end);
+	msg("Write dtb to %p\n", fdt);
+	r = dt_fixup_stream(src, fdt, DTB_MAX_SIZE, &chosen_ops, NULL);
+	if (r < 0)
+		msg("Kernel DTB: %s\n", fdt_strerror(r));
+	CHECK(r < 0);
+	boot_phase_end(phase);
 }
 
-#define OPTEE_MAGIC		0x4554504f
-#define OPTEE_VERSION		1
-#define OPTEE_ARCH_ARM32	0
-#define OPTEE_ARCH_ARM64	1
+/*
+ * Writes the DTB for the kernel at dtb_addr from src. After this only the
+ * boot times are updated, in place.
+ */
+static void setup_kernel_dtb(const void *src)
+{
+	void *fdt = (void *)dtb_addr;
 
+	/* An overlay is merged in a live tree, or at build time */
+	if (&__linker_nsec_dtbo_start != &__linker_nsec_dtbo_end &&
+	    !dt_fixup_fdt_is_prefixed(src))
+		build_kernel_dtb_live(src, fdt);
+	else
+		build_kernel_dtb(src, fdt);
 
-struct optee_header {
-	uint32_t magic;
-	uint8_t version;
-	uint8_t arch;
-	uint16_t flags;
-	uint32_t init_size;
-	uint32_t init_load_addr_hi;
-	uint32_t init_load_addr_lo;
-	uint32_t init_mem_usage;
-	uint32_t paged_size;
-};
+	add_handoff_range(dtb_addr, dtb_addr + fdt_totalsize(fdt));
+}
 
+/* The memory map the DTB fixups resolved, for the boot information */
+static void setup_boot_info_mem(void)
+{
+	struct interval secure_ivs[BOOT_INFO_MAX_SECURE];
+	struct interval nsec_ivs[BOOT_INFO_MAX_NSEC];
+	struct interval_set secure;
+	struct interval_set nsec;
+	bool ok;
+
+	interval_set_init(&secure, secure_ivs, ARRAY_SIZE(secure_ivs));
+	interval_set_init(&nsec, nsec_ivs, ARRAY_SIZE(nsec_ivs));
+	ok = dt_fixup_mem_map(&secure, &nsec) &&
+	     boot_info_set_mem(&secure, &nsec, TZ_SHM_SIZE ? TZ_SHM_START : 0,
+			       TZ_SHM_SIZE);
+	CHECK(!ok);
+}
 
-struct sec_entry_arg {
-	uint32_t entry;
-	uint32_t paged_part;
-	uint32_t fdt;
-};
 /* called from assembly only */
 void main_init_sec(struct sec_entry_arg *arg);
 void main_init_sec(struct sec_entry_arg *arg)
 {
-	void *fdt;
-	int r;
-	const uint8_t *sblob_start = &__linker_secure_blob_start;
-	const uint8_t *sblob_end = &__linker_secure_blob_end;
+	struct bios_image img;
 	struct optee_header hdr;
 	size_t pg_part_size;
 	uint32_t pg_part_dst;
+	const void *dtb;
 
+	boot_info_init();
 	msg_init();
+	pmu_init();
+	report_boot_copy();
+	mmu_init();
+	smp_init();
 
-	/* Find DTB */
-	fdt = open_fdt(DTB_START, &__linker_nsec_dtb_start,
-			&__linker_nsec_dtb_end);
-	tz_res_mem(fdt);
-	tz_res_uart(fdt);
-	tz_add_optee_node(fdt);
-	r = fdt_pack(fdt);
-	CHECK(r < 0);
-
-	/* Look for a header first */
-	CHECK(((intptr_t)sblob_end - (intptr_t)sblob_start) <
-		(ssize_t)sizeof(hdr));
-	copy_bios_image("secure header", (uint32_t)&hdr, sblob_start,
-			sblob_start + sizeof(hdr));
+	/*
+	 * The secure blob is a header followed by the init part and the
+	 * paged part, read in that order as it may be compressed.
+	 */
+	open_bios_image(&img, &__linker_secure_blob_start,
+			&__linker_secure_blob_end, MANIFEST_SECURE_BLOB);
+	CHECK(bios_image_size(&img) < sizeof(hdr));
+	read_bios_image("secure blob", &hdr, &img, sizeof(hdr));
 
 	CHECK(hdr.magic != OPTEE_MAGIC || hdr.version != OPTEE_VERSION);
 
 	msg("found secure header\n");
-	sblob_start += sizeof(hdr);
 	CHECK(hdr.init_load_addr_hi != 0);
+	CHECK(hdr.init_size > bios_image_size(&img));
 
-	pg_part_size = sblob_end - sblob_start - hdr.init_size;
+	pg_part_size = bios_image_size(&img) - hdr.init_size;
 	pg_part_dst = (size_t)TZ_RES_MEM_START + TZ_RES_MEM_SIZE - pg_part_size;
 
-	copy_bios_image("secure paged part",
-			pg_part_dst, sblob_start + hdr.init_size, sblob_end);
-
-	sblob_end -= pg_part_size;
-
 	arg->paged_part = pg_part_dst;
 	arg->entry = hdr.init_load_addr_lo;
 
 	/* Copy secure image in place */
-	copy_bios_image("secure blob", hdr.init_load_addr_lo, sblob_start,
-			sblob_end);
+	copy_bios_image("secure blob", hdr.init_load_addr_lo, &img,
+			hdr.init_size);
+
+	copy_bios_image("secure paged part", pg_part_dst, &img, pg_part_size);
 
 	/*
 	 * Copy NS images as while we can read the secure flash from where
 	 * we load them.
 	 */
-	copy_ns_images();
+	dtb = kernel_dtb_source(&__linker_nsec_dtb_start,
+				&__linker_nsec_dtb_end);
+	copy_ns_images(dtb);
+	setup_kernel_dtb(dtb);
 	arg->fdt = dtb_addr;
+	arg->shm = TZ_SHM_SIZE ? TZ_SHM_START : 0;
+	arg->shm_size = TZ_SHM_SIZE;
 
-	msg("Initializing secure world\n");
-}
-
-static void setprop_cell(void *fdt, const char *node_path,
-		const char *property, uint32_t val)
-{
-	int offs;
-	int r;
+	setup_boot_info_mem();
+#ifdef TZ_UART_SHARED
+	boot_info_set_images_loaded(CONSOLE_UART_BASE, dtb_addr);
+#else
+	boot_info_set_images_loaded(UART1_BASE, dtb_addr);
+#endif
 
-	offs = fdt_path_offset(fdt, node_path);
-	CHECK(offs < 0);
+	/* All copies are done, the secondary cores wait in flash */
+	smp_stop();
+	arg->boot_info = boot_info_finish(smp_num_cpus());
+	clean_handoff_ranges();
+	smp_handoff(arg->entry);
+	msg("Initializing secure world\n");
 
-	r = fdt_setprop_cell(fdt, offs, property, val);
-	CHECK(r < 0);
+	/* Ended by main_init_ns() once the secure world is initialized */
+	boot_phase_restart(secure_world_phase);
 }
 
-static void setprop_string(void *fdt, const char *node_path,
-		const char *property, const char *string)
+/* Per phase time and PMU counts, to tell memory from instruction bound */
+static void report_boot_times(void)
 {
-	int offs;
-	int r;
-
-	offs = fdt_path_offset(fdt, node_path);
-	CHECK(offs < 0);
-
-	r = fdt_setprop_string(fdt, offs, property, string);
-	CHECK(r < 0);
+	uint32_t freq = boot_time_freq();
+	const struct boot_phase *p;
+	uint64_t ticks;
+	uint64_t us;
+	size_t n;
+
+	msg("Boot phases (timer frequency %" PRIu32 " Hz):\n", freq);
+	msg("  %-18s %10s %8s %10s %10s %8s %8s\n", "phase", "ticks", "us",
+		"cycles", "insts", "l1d-refl", "br-miss");
+	for (n = 0; n < boot_phase_count(); n++) {
+		p = boot_phase_get(n);
+		ticks = p->end - p->start;
+		us = 0;
+		if (freq)
+			us = ticks * 1000000 / freq;
+		msg("  %-18s %10" PRIu64 " %8" PRIu64 " %10" PRIu32
+			" %10" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n",
+			p->name, ticks, us,
+			p->pmu.cycles, p->pmu.events[PMU_INST_RETIRED],
+			p->pmu.events[PMU_L1D_CACHE_REFILL],
+			p->pmu.events[PMU_BR_MIS_PRED]);
+	}
 }
 
 typedef void (*kernel_ep_func)(uint32_t a0, uint32_t a1, uint32_t a2);
-static void call_kernel(uint32_t entry, uint32_t dtb,
-		uint32_t initrd, uint32_t initrd_end)
+static void call_kernel(uint32_t entry, uint32_t dtb)
 {
 	kernel_ep_func ep = (kernel_ep_func)entry;
-	void *fdt = (void *)dtb;
-	const char cmdline[] = COMMAND_LINE;
-	int r;
 	const uint32_t a0 = 0;
 	/*MACH_VEXPRESS see linux/arch/arm/tools/mach-types*/
 	const uint32_t a1 = 2272;
+	int r;
 
-	r = fdt_open_into(fdt, fdt, DTB_MAX_SIZE);
-	CHECK(r < 0);
-	setprop_cell(fdt, "/chosen", "linux,initrd-start", initrd);
-	setprop_cell(fdt, "/chosen", "linux,initrd-end", initrd_end);
-	setprop_string(fdt, "/chosen", "bootargs", cmdline);
-	r = fdt_pack(fdt);
-	CHECK(r < 0);
+	/* The DTB is final, only the boot times are updated in place */
+	boot_phase_end(kernel_phase);
+	report_boot_times();
+	r = boot_time_update_fdt((void *)dtb);
+	if (r < 0)
+		msg("Boot times not updated in the DTB: %d\n", r);
 
-	msg("kernel command line: \"%s\"\n", cmdline);
+	msg("kernel command line: \"%s\"\n", COMMAND_LINE);
 	msg("Entering kernel at 0x%x with r0=0x%x r1=0x%x r2=0x%x\n",
 		(uintptr_t)ep, a0, a1, dtb);
 	ep(a0, a1, dtb);
@@ -646,5 +849,7 @@ static void call_kernel(uint32_t entry, uint32_t dtb,
 void main_init_ns(void); /* called from assembly only */
 void main_init_ns(void)
 {
-	call_kernel(kernel_entry, dtb_addr, rootfs_start, rootfs_end);
+	boot_phase_end(secure_world_phase);
+	boot_phase_restart(kernel_phase);
+	call_kernel(kernel_entry, dtb_addr);
 }
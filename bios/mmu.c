@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "platform_config.h"
+
+#include <arm32.h>
+#include <compiler.h>
+#include <types_ext.h>
+#include "mmu.h"
+
+#define SECTION_SHIFT		20
+#define NUM_SECTIONS		4096
+
+#define SECTION_SECT		(2 << 0)
+#define SECTION_B		(1 << 2)
+#define SECTION_C		(1 << 3)
+#define SECTION_XN		(1 << 4)
+#define SECTION_AP_RW		(3 << 10)
+#define SECTION_TEX(x)		((x) << 12)
+#define SECTION_S		(1 << 16)
+
+/* Normal memory, inner and outer write-back write-allocate */
+#define SECTION_NORMAL		(SECTION_SECT | SECTION_TEX(1) | SECTION_C | \
+				 SECTION_B | SECTION_S | SECTION_AP_RW)
+/* Shareable device memory */
+#define SECTION_DEVICE		(SECTION_SECT | SECTION_B | SECTION_XN | \
+				 SECTION_AP_RW)
+
+/* Table walks are inner and outer write-back write-allocate, shareable */
+#define TTBR_IRGN_WBWA		(1 << 6)
+#define TTBR_RGN_WBWA		(1 << 3)
+#define TTBR_S			(1 << 1)
+
+#define DACR_CLIENT(domain)	(1 << ((domain) * 2))
+
+static uint32_t l1_table[NUM_SECTIONS] __aligned(NUM_SECTIONS * 4);
+
+static void map_sections(paddr_t pa, uint64_t size, uint32_t attr)
+{
+	size_t idx = pa >> SECTION_SHIFT;
+	size_t end = idx + (size >> SECTION_SHIFT);
+
+	for (; idx < end && idx < NUM_SECTIONS; idx++)
+		l1_table[idx] = (idx << SECTION_SHIFT) | attr;
+}
+
+/* Invalidates the data caches by set/way up to, but not including, level */
+static void dcache_inv_levels(uint32_t clidr, uint32_t num_levels)
+{
+	uint32_t level;
+
+	for (level = 0; level < num_levels; level++) {
+		uint32_t ctype = (clidr >> (level * 3)) & CLIDR_CTYPE_MASK;
+		uint32_t ccsidr;
+		uint32_t line_shift;
+		uint32_t way_shift;
+		uint32_t ways;
+		uint32_t sets;
+		uint32_t way;
+		uint32_t set;
+
+		if (ctype < CLIDR_CTYPE_DCACHE)
+			continue;
+
+		write_csselr(level << 1);
+		isb();
+		ccsidr = read_ccsidr();
+		line_shift = (ccsidr & CCSIDR_LINESIZE_MASK) + 4;
+		ways = ((ccsidr >> CCSIDR_ASSOC_SHIFT) & CCSIDR_ASSOC_MASK) + 1;
+		sets = ((ccsidr >> CCSIDR_NUMSETS_SHIFT) &
+			CCSIDR_NUMSETS_MASK) + 1;
+		way_shift = ways > 1 ? __builtin_clz(ways - 1) : 0;
+
+		for (way = 0; way < ways; way++)
+			for (set = 0; set < sets; set++)
+				write_dcisw((way << way_shift) |
+					    (set << line_shift) | (level << 1));
+	}
+	dsb();
+}
+
+static size_t dcache_line_size(void)
+{
+	uint32_t ctr = read_ctr();
+
+	return 4 << ((ctr >> CTR_DMINLINE_SHIFT) & CTR_DMINLINE_MASK);
+}
+
+void cache_clean_range(vaddr_t va, size_t len)
+{
+	size_t line = dcache_line_size();
+	vaddr_t end = va + len;
+
+	for (va &= ~(line - 1); va < end; va += line)
+		write_dccmvac(va);
+	dsb();
+}
+
+void cache_inv_range(vaddr_t va, size_t len)
+{
+	size_t line = dcache_line_size();
+	vaddr_t end = va + len;
+
+	/* Partial lines at the edges may hold data outside the range */
+	if (va & (line - 1)) {
+		write_dccimvac(va & ~(line - 1));
+		va = (va & ~(line - 1)) + line;
+	}
+	if (end & (line - 1)) {
+		end &= ~(line - 1);
+		if (end >= va)
+			write_dccimvac(end);
+	}
+
+	for (; va < end; va += line)
+		write_dcimvac(va);
+	dsb();
+}
+
+void cache_clean_inv_range(vaddr_t va, size_t len)
+{
+	size_t line = dcache_line_size();
+	vaddr_t end = va + len;
+
+	for (va &= ~(line - 1); va < end; va += line)
+		write_dccimvac(va);
+	dsb();
+}
+
+static void mmu_enable(void)
+{
+	write_ttbcr(0);
+	write_ttbr0((uint32_t)l1_table | TTBR_IRGN_WBWA | TTBR_RGN_WBWA |
+		    TTBR_S);
+	write_dacr(DACR_CLIENT(0));
+	isb();
+
+	write_sctlr(read_sctlr() | SCTLR_M | SCTLR_C | SCTLR_I | SCTLR_Z);
+	isb();
+}
+
+void mmu_init(void)
+{
+	uint32_t clidr = read_clidr();
+
+	map_sections(0, (uint64_t)NUM_SECTIONS << SECTION_SHIFT, SECTION_DEVICE);
+	map_sections(FLASH_START, FLASH_SIZE, SECTION_NORMAL);
+	map_sections(DRAM_START, DRAM_MAX_SIZE, SECTION_NORMAL);
+
+	/* Take part in coherency before any cache or TLB maintenance */
+	write_actlr(read_actlr() | ACTLR_SMP);
+	isb();
+
+	dcache_inv_levels(clidr, (clidr >> CLIDR_LOC_SHIFT) & CLIDR_LOC_MASK);
+	write_iciallu();
+	write_bpiall();
+	write_tlbiallis();
+	dsb();
+
+	mmu_enable();
+}
+
+void mmu_init_secondary(void)
+{
+	uint32_t clidr = read_clidr();
+
+	write_actlr(read_actlr() | ACTLR_SMP);
+	isb();
+
+	/*
+	 * Only the caches private to this core, the shared levels may hold
+	 * dirty lines of the primary core by now.
+	 */
+	dcache_inv_levels(clidr, (clidr >> CLIDR_LOUIS_SHIFT) & CLIDR_LOC_MASK);
+	write_iciallu();
+	write_bpiall();
+	write_tlbiall();
+	dsb();
+
+	mmu_enable();
+}
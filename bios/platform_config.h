@@ -42,6 +42,9 @@
 #define TZ_RES_MEM_START	TZ_RAM_START
 
 #define DRAM_START		0x80000000
+#define DRAM_MAX_SIZE		0x80000000
+
+#define BIOS_MAX_CORES		4
 
 #define UART0_BASE		0x1c090000
 #define UART1_BASE		0x1c0a0000
@@ -51,6 +54,9 @@
 #define TZ_RES_MEM_START	TZ_RAM_START
 
 #define DRAM_START		0x40000000
+#define DRAM_MAX_SIZE		0xc0000000
+
+#define BIOS_MAX_CORES		8
 
 #define UART0_BASE		0x09000000
 #define UART1_BASE		0x09040000
@@ -62,10 +68,31 @@
 
 #define CONSOLE_UART_BASE	UART0_BASE
 
+#define FLASH_START		0x00000000
+#define FLASH_SIZE		0x04000000
+
 #define DTB_MAX_SIZE		0x10000
 #define TZ_RES_MEM_SIZE		(0x02000000 + 0x100000)
 
+/*
+ * Define TZ_SDP_MEM_START and TZ_SDP_MEM_SIZE to also keep secure data
+ * path DMA buffers out of the memory passed to the normal world.
+ */
+
+/* OP-TEE static shared memory, see BIOS_TZ_SHM_SIZE in conf.mk */
+#ifndef TZ_SHM_SIZE
+#define TZ_SHM_SIZE		0
+#endif
+#define TZ_SHM_START		(TZ_RES_MEM_START - TZ_SHM_SIZE)
+
 #define DTB_START		DRAM_START
 #define BIOS_RAM_START		(DRAM_START + 0x100000)
 
+/* Stack of each secondary core while it's helping to load images */
+#define BIOS_SECONDARY_STACK_SIZE	2048
+
+/* Unused RAM between the DTB and the BIOS, free for temporary use */
+#define BIOS_SCRATCH_START	(DTB_START + DTB_MAX_SIZE)
+#define BIOS_SCRATCH_SIZE	(BIOS_RAM_START - BIOS_SCRATCH_START)
+
 #endif /*PLATFORM_CONFIG_H*/
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <arm32.h>
+#include "pmu.h"
+
+/* Common architectural event numbers, ARMv7-A PMUv2 */
+static const uint8_t event_nums[PMU_NUM_EVENTS] = {
+	[PMU_INST_RETIRED] = 0x08,
+	[PMU_L1D_CACHE_REFILL] = 0x03,
+	[PMU_BR_MIS_PRED] = 0x10,
+};
+
+static size_t num_counters;
+
+void pmu_init(void)
+{
+	uint32_t pmcr = read_pmcr();
+	size_t n;
+
+	num_counters = (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK;
+	if (num_counters > PMU_NUM_EVENTS)
+		num_counters = PMU_NUM_EVENTS;
+
+	for (n = 0; n < num_counters; n++) {
+		write_pmselr(n);
+		isb();
+		write_pmxevtyper(event_nums[n]);
+		write_pmxevcntr(0);
+	}
+
+	write_pmcntenset(PMCNTENSET_C | ((1 << num_counters) - 1));
+	write_pmcr(pmcr | PMCR_E);
+	isb();
+}
+
+void pmu_read(struct pmu_counts *counts)
+{
+	size_t n;
+
+	counts->cycles = read_pmccntr();
+	for (n = 0; n < PMU_NUM_EVENTS; n++) {
+		if (n < num_counters) {
+			write_pmselr(n);
+			isb();
+			counts->events[n] = read_pmxevcntr();
+		} else {
+			counts->events[n] = 0;
+		}
+	}
+}
+
+void pmu_diff(struct pmu_counts *res, const struct pmu_counts *start,
+	      const struct pmu_counts *end)
+{
+	size_t n;
+
+	res->cycles = end->cycles - start->cycles;
+	for (n = 0; n < PMU_NUM_EVENTS; n++)
+		res->events[n] = end->events[n] - start->events[n];
+}
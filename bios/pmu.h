@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef PMU_H
+#define PMU_H
+
+#include <types_ext.h>
+
+/* Events counted next to the cycle counter, in counter order */
+enum pmu_event {
+	PMU_INST_RETIRED,
+	PMU_L1D_CACHE_REFILL,
+	PMU_BR_MIS_PRED,
+	PMU_NUM_EVENTS
+};
+
+struct pmu_counts {
+	uint32_t cycles;
+	uint32_t events[PMU_NUM_EVENTS];
+};
+
+/*
+ * Programs the event counters and enables them together with the cycle
+ * counter, which entry.S has started already. Events without a counter
+ * on this CPU read as 0.
+ */
+void pmu_init(void);
+
+void pmu_read(struct pmu_counts *counts);
+
+/* Sets res to end - start, counters are free running and may wrap */
+void pmu_diff(struct pmu_counts *res, const struct pmu_counts *start,
+	      const struct pmu_counts *end);
+
+#endif /*PMU_H*/
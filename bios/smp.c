@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "platform_config.h"
+
+#include <arm32.h>
+#include <compiler.h>
+#include <string.h>
+#include "mmu.h"
+#include "smp.h"
+
+#ifndef MIN
+#define MIN(a, b) \
+	(__extension__({ __typeof__(a) _a = (a); \
+			 __typeof__(b) _b = (b); \
+			 _a < _b ? _a : _b; }))
+#endif
+
+/* Round up the even multiple of size, size has to be a multiple of 2 */
+#define ROUNDUP(v, size) (((v) + (size - 1)) & ~(size - 1))
+
+/* Copies smaller than this aren't split between cores */
+#define SMP_COPY_MIN_SIZE	(64 * 1024)
+#define SMP_CACHE_LINE_SIZE	64
+
+/*
+ * One job slot per core, written by the primary core and completed by
+ * the secondary core. Each slot has its own cache line.
+ */
+struct smp_job {
+	const void *src;
+	void *dst;
+	size_t len;
+	uint32_t seq;
+	uint32_t done;
+	bool online;
+	bool stop;
+} __aligned(SMP_CACHE_LINE_SIZE);
+
+uint32_t smp_release;
+/* Where the hold loop in entry.S sends the cores, set by smp_handoff() */
+uint32_t smp_secure_entry;
+/* Only written by the secondary cores, with the MMU off */
+uint32_t smp_pen_state[BIOS_MAX_CORES][SMP_PEN_STATE_SIZE / 4]
+	__aligned(SMP_PEN_STATE_SIZE);
+
+static size_t num_cpus = 1;
+
+static volatile struct smp_job jobs[BIOS_MAX_CORES];
+static bool job_busy[BIOS_MAX_CORES];
+
+/* Stacks of the secondary cores, set up by entry.S */
+uint8_t smp_stacks[BIOS_MAX_CORES - 1][BIOS_SECONDARY_STACK_SIZE]
+	__attribute__((section(".bss.prebss.smp_stacks"), aligned(8)));
+
+void smp_init(void)
+{
+	/* The secondary cores read the release flag with caches off */
+	smp_release = SMP_RELEASE_MAGIC;
+	cache_clean_range((vaddr_t)&smp_release, sizeof(smp_release));
+	sev();
+}
+
+static size_t online_cpus(bool *online)
+{
+	size_t num = 0;
+	size_t n;
+
+	for (n = 1; n < BIOS_MAX_CORES; n++) {
+		online[n] = jobs[n].online;
+		if (online[n])
+			num++;
+	}
+	return num;
+}
+
+static void start_job(size_t cpu, void *dst, const void *src, size_t len)
+{
+	jobs[cpu].src = src;
+	jobs[cpu].dst = dst;
+	jobs[cpu].len = len;
+	dmb();
+	jobs[cpu].seq++;
+	job_busy[cpu] = true;
+}
+
+/*
+ * Splits the copy into num_parts cache line aligned parts, the first one
+ * is left to the primary core if primary_part is true. Returns the
+ * length of that part.
+ */
+static size_t start_parts(void *dst, const void *src, size_t len,
+		bool primary_part)
+{
+	bool online[BIOS_MAX_CORES];
+	size_t num_parts = online_cpus(online) + primary_part;
+	size_t part_len;
+	size_t offs;
+	size_t n;
+
+	part_len = ROUNDUP(len / num_parts, SMP_CACHE_LINE_SIZE);
+	offs = primary_part ? part_len : 0;
+	for (n = 1; n < BIOS_MAX_CORES && offs < len; n++) {
+		if (!online[n])
+			continue;
+		start_job(n, (uint8_t *)dst + offs, (const uint8_t *)src + offs,
+			  MIN(part_len, len - offs));
+		offs += part_len;
+	}
+	dsb();
+	sev();
+
+	return primary_part ? MIN(part_len, len) : 0;
+}
+
+bool smp_copy_start(void *dst, const void *src, size_t len)
+{
+	bool online[BIOS_MAX_CORES];
+
+	if (len < SMP_COPY_MIN_SIZE || !online_cpus(online))
+		return false;
+
+	start_parts(dst, src, len, false);
+	return true;
+}
+
+void smp_copy_wait(void)
+{
+	size_t n;
+
+	for (n = 1; n < BIOS_MAX_CORES; n++) {
+		if (!job_busy[n])
+			continue;
+		while (jobs[n].done != jobs[n].seq)
+			wfe();
+		job_busy[n] = false;
+	}
+	dmb();
+}
+
+void smp_copy(void *dst, const void *src, size_t len)
+{
+	bool online[BIOS_MAX_CORES];
+	size_t l;
+
+	if (len < SMP_COPY_MIN_SIZE || !online_cpus(online)) {
+		memcpy(dst, src, len);
+		return;
+	}
+
+	l = start_parts(dst, src, len, true);
+	memcpy(dst, src, l);
+	smp_copy_wait();
+}
+
+static uint32_t pen_state(size_t cpu)
+{
+	volatile uint32_t *state = smp_pen_state[cpu];
+
+	/* Any line in the cache is stale, the core writes with caches off */
+	cache_inv_range((vaddr_t)state, sizeof(*state));
+	return *state;
+}
+
+void smp_stop(void)
+{
+	size_t n;
+
+	smp_copy_wait();
+
+	/* Cores online from now on see the stop flag and leave */
+	for (n = 1; n < BIOS_MAX_CORES; n++)
+		jobs[n].stop = true;
+
+	/*
+	 * A core marks itself arrived before it reads the release flag, so
+	 * it either sees the stop and goes to the hold loop or is found
+	 * arrived below.
+	 */
+	smp_release = SMP_STOP_MAGIC;
+	cache_clean_range((vaddr_t)&smp_release, sizeof(smp_release));
+	sev();
+
+	for (n = 1; n < BIOS_MAX_CORES; n++) {
+		if (!pen_state(n))
+			continue;
+		while (pen_state(n) != SMP_PEN_STOPPED)
+			wfe();
+		num_cpus++;
+	}
+}
+
+void smp_handoff(uint32_t entry)
+{
+	/* Read by the hold loop with caches off */
+	smp_secure_entry = entry;
+	cache_clean_range((vaddr_t)&smp_secure_entry,
+			  sizeof(smp_secure_entry));
+	sev();
+}
+
+size_t smp_num_cpus(void)
+{
+	return num_cpus;
+}
+
+void smp_secondary_main(size_t cpu)
+{
+	volatile struct smp_job *job = jobs + cpu;
+	uint32_t seq;
+
+	mmu_init_secondary();
+	seq = job->seq;
+
+	job->online = true;
+	dsb();
+
+	while (!job->stop) {
+		if (job->seq == seq) {
+			wfe();
+			continue;
+		}
+
+		dmb();
+		seq = job->seq;
+		memcpy(job->dst, (const void *)job->src, job->len);
+		dmb();
+		job->done = seq;
+		dsb();
+		sev();
+	}
+
+	/* entry.S marks the core stopped once its MMU is off */
+	job->online = false;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef SMP_H
+#define SMP_H
+
+/*
+ * Secondary cores wait in the holding pen in entry.S until smp_release
+ * is first seen as 0, cleared by the primary core in reset, and then as
+ * SMP_RELEASE_MAGIC. A value left in RAM from an earlier boot can't
+ * release them early that way. SMP_STOP_MAGIC, set by smp_stop(), sends
+ * cores still in the pen to the hold loop instead.
+ */
+#define SMP_RELEASE_MAGIC	0x52504d53
+#define SMP_STOP_MAGIC		0x504f5453
+
+/*
+ * State of each secondary core in smp_pen_state, written with the MMU
+ * off. A core is ARRIVED once it has seen the release flag set and
+ * STOPPED once it's on its way to the hold loop. Each core has its own
+ * SMP_PEN_STATE_SIZE bytes, at least a cache line.
+ */
+#define SMP_PEN_ARRIVED		1
+#define SMP_PEN_STOPPED		2
+#define SMP_PEN_STATE_SHIFT	6
+#define SMP_PEN_STATE_SIZE	(1 << SMP_PEN_STATE_SHIFT)
+
+#ifndef ASM
+#include <types_ext.h>
+
+extern uint32_t smp_release;
+
+/*
+ * Releases the secondary cores from the holding pen, they join the
+ * copies started after they've come online. Must be called after
+ * mmu_init().
+ */
+void smp_init(void);
+
+/*
+ * Copies len bytes from src to dst in equal parts on all online cores,
+ * the primary core included.
+ */
+void smp_copy(void *dst, const void *src, size_t len);
+
+/*
+ * Starts copying on the online secondary cores only, leaving the primary
+ * core free for other work until smp_copy_wait(). Returns false without
+ * starting anything if no secondary core is online or if the copy is too
+ * small to be worth splitting.
+ */
+bool smp_copy_start(void *dst, const void *src, size_t len);
+void smp_copy_wait(void);
+
+/*
+ * Join barrier before the secure world is entered. Returns once every
+ * secondary core released by smp_init() has left the BIOS RAM for the
+ * hold loop in flash, with its MMU and caches off. Cores still in the
+ * holding pen go to the hold loop without being released.
+ */
+void smp_stop(void);
+
+/*
+ * Sends the secondary cores in the hold loop on to entry, the secure
+ * world's own hold loop for cores it hasn't brought up yet, as the cores
+ * would enter it without the BIOS. Must be called after smp_stop() once
+ * the secure world is in memory.
+ */
+void smp_handoff(uint32_t entry);
+
+/* The primary core and the secondary cores that reached the BIOS */
+size_t smp_num_cpus(void);
+
+/* Called from entry.S only */
+void smp_secondary_main(size_t cpu);
+#endif /*!ASM*/
+
+#endif /*SMP_H*/
@@ -1,3 +1,11 @@
 global-incdirs-y += .
 srcs-y += entry.S
+srcs-y += boot_info.c
+srcs-y += boot_time.c
+srcs-y += dt_fixup.c
+srcs-y += dt_match.c
+srcs-y += layout.c
 srcs-y += main.c
+srcs-y += mmu.c
+srcs-y += pmu.c
+srcs-y += smp.c
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Applies the secure world fixups of the BIOS, and optionally a DTB
+ * overlay, to a DTB at build time and marks it as fixed up. The BIOS
+ * then only updates /chosen at boot.
+ *
+ * Usage: dtb_prefixup [-v] <in.dtb> <out.dtb> [overlay.dtbo]
+ */
+#include "platform_config.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libfdt.h>
+#include "dt_fixup.h"
+#include "msg.h"
+
+static bool verbose;
+static const char *prog;
+
+void msg(const char *fmt, ...)
+{
+	va_list ap;
+
+	if (!verbose)
+		return;
+
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+}
+
+void check(const char *expr, const char *file, int line)
+{
+	fprintf(stderr, "%s: check \"%s\": %s:%d\n", prog, expr, file, line);
+	exit(EXIT_FAILURE);
+}
+
+static void *read_file(const char *name, size_t *size)
+{
+	FILE *f = fopen(name, "rb");
+	void *buf;
+	long l;
+
+	if (!f || fseek(f, 0, SEEK_END) || (l = ftell(f)) < 0 ||
+	    fseek(f, 0, SEEK_SET)) {
+		fprintf(stderr, "%s: %s: %s\n", prog, name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	buf = malloc(l);
+	if (!buf || fread(buf, 1, l, f) != (size_t)l) {
+		fprintf(stderr, "%s: %s: read failed\n", prog, name);
+		exit(EXIT_FAILURE);
+	}
+	fclose(f);
+	*size = l;
+	return buf;
+}
+
+static void write_file(const char *name, const void *buf, size_t size)
+{
+	FILE *f = fopen(name, "wb");
+
+	if (!f || fwrite(buf, 1, size, f) != size || fclose(f)) {
+		fprintf(stderr, "%s: %s: %s\n", prog, name, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void check_fdt(const char *name, const void *fdt, size_t size)
+{
+	int r = fdt_check_full(fdt, size);
+
+	if (r) {
+		fprintf(stderr, "%s: %s: %s\n", prog, name, fdt_strerror(r));
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct fdt_live_tree tree;
+	void *dtb;
+	void *dtbo = NULL;
+	void *arena;
+	void *out;
+	size_t dtb_size;
+	size_t dtbo_size = 0;
+	size_t arena_size;
+	int r;
+
+	prog = argv[0];
+	if (argc > 1 && !strcmp(argv[1], "-v")) {
+		verbose = true;
+		argc--;
+		argv++;
+	}
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr,
+			"Usage: %s [-v] <in.dtb> <out.dtb> [overlay.dtbo]\n",
+			prog);
+		return EXIT_FAILURE;
+	}
+
+	dtb = read_file(argv[1], &dtb_size);
+	check_fdt(argv[1], dtb, dtb_size);
+	if (argc > 3) {
+		dtbo = read_file(argv[3], &dtbo_size);
+		check_fdt(argv[3], dtbo, dtbo_size);
+	}
+
+	/* Far more than the nodes and properties of both can take */
+	arena_size = 8 * (dtb_size + dtbo_size) + 0x10000;
+	arena = calloc(1, arena_size);
+	out = calloc(1, DTB_MAX_SIZE);
+	CHECK(!arena || !out);
+
+	r = fdt_live_unflatten(dtb, &tree, arena, arena_size);
+	CHECK(r < 0);
+	if (dt_fixup_is_prefixed(&tree)) {
+		fprintf(stderr, "%s: %s: already fixed up\n", prog, argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	dt_fixup_tz_res_mem(&tree);
+	dt_fixup_tz_res_uart(&tree);
+	dt_fixup_optee_node(&tree);
+	if (dtbo) {
+		r = fdt_live_overlay_apply(&tree, dtbo);
+		if (r < 0) {
+			fprintf(stderr, "%s: %s: %s\n", prog, argv[3],
+				fdt_strerror(r));
+			return EXIT_FAILURE;
+		}
+	}
+	dt_fixup_mark_prefixed(&tree);
+
+	r = fdt_live_flatten(&tree, out, DTB_MAX_SIZE);
+	if (r < 0) {
+		fprintf(stderr, "%s: %s: %s\n", prog, argv[2],
+			fdt_strerror(r));
+		return EXIT_FAILURE;
+	}
+	write_file(argv[2], out, fdt_totalsize(out));
+
+	return EXIT_SUCCESS;
+}
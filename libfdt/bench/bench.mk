@@ -0,0 +1,18 @@
+# Native host build of libfdt with a benchmark over synthetic device
+# trees, not part of all:
+#   make fdt-bench && out/host/fdt_bench [-i] [nodes...]
+include libfdt/Makefile.libfdt
+
+HOSTCC		?= gcc
+fdt-bench-bin := $(out-dir)host/fdt_bench
+fdt-bench-srcs := libfdt/bench/fdt_bench.c \
+		  $(addprefix libfdt/,$(LIBFDT_SRCS))
+cleanfiles += $(fdt-bench-bin)
+
+.PHONY: fdt-bench
+fdt-bench: $(fdt-bench-bin)
+
+$(fdt-bench-bin): $(fdt-bench-srcs) $(wildcard libfdt/*.h libfdt/include/*.h)
+	@echo '  HOSTCC  $@'
+	@mkdir -p $(dir $@)
+	$(q)$(HOSTCC) -O2 -Ilibfdt/include -Ilibfdt -o $@ $(fdt-bench-srcs)
@@ -0,0 +1,533 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Host benchmark of libfdt over synthetic device trees, from hundreds
+ * to tens of thousands of nodes. Reports the time per operation and the
+ * bytes the operation moves or copies, or for fdt_pack() frees.
+ *
+ * Usage: fdt_bench [-i] [nodes...]
+ *	-i	use the node and strings block indexes
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libfdt.h>
+
+#define DEVS_PER_BUS	64
+#define NUM_COMPATS	32
+#define MAX_OPS		20000
+#define MAX_EDITS	1000
+#define MIN_NS		100000000ULL	/* Run repeatable ops for 100 ms */
+#define STRINGS_SLOTS	4096
+
+struct bench_tree {
+	void *fdt;
+	int size;
+	int num_nodes;
+	int num_devs;
+	char (*paths)[64];
+	bool indexed;
+};
+
+static struct fdt_index node_idx;
+static struct fdt_index_entry *node_entries;
+static struct fdt_strings_index strings_idx;
+static uint32_t strings_slots[STRINGS_SLOTS];
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+	/* Numerical Recipes LCG, enough to spread the lookups */
+	rnd_state = rnd_state * 1664525 + 1013904223;
+	return rnd_state >> 8;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check(int err, const char *what)
+{
+	if (err < 0) {
+		fprintf(stderr, "fdt_bench: %s: %s\n", what, fdt_strerror(err));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void report(const struct bench_tree *t, const char *op, long ops,
+		   uint64_t ns, uint64_t bytes)
+{
+	printf("%7d %9d %-28s %7ld %11.1f %11.1f\n", t->num_nodes, t->size,
+	       op, ops, (double)ns / ops, (double)bytes / ops);
+}
+
+/*
+ * A tree shaped like an SoC: a few CPUs, memory, and buses of devices
+ * with reg, interrupts, status and one of NUM_COMPATS compatibles, every
+ * fourth device with a port subnode.
+ */
+static void build_tree(struct bench_tree *t, int num_nodes)
+{
+	int num_buses = (num_nodes + DEVS_PER_BUS - 1) / DEVS_PER_BUS;
+	fdt32_t reg[4];
+	char name[32];
+	char compat[32];
+	void *fdt;
+	int b, d, n;
+
+	t->size = num_nodes * 160 + 4096;
+	t->fdt = fdt = malloc(t->size);
+	t->paths = malloc(num_buses * DEVS_PER_BUS * sizeof(*t->paths));
+	if (!fdt || !t->paths)
+		check(-FDT_ERR_NOSPACE, "malloc");
+	t->num_devs = 0;
+
+	check(fdt_create(fdt, t->size), "fdt_create");
+	check(fdt_add_reservemap_entry(fdt, 0x80000000, 0x100000),
+	      "fdt_add_reservemap_entry");
+	check(fdt_finish_reservemap(fdt), "fdt_finish_reservemap");
+
+	check(fdt_begin_node(fdt, ""), "fdt_begin_node");
+	check(fdt_property_u32(fdt, "#address-cells", 2), "fdt_property");
+	check(fdt_property_u32(fdt, "#size-cells", 2), "fdt_property");
+	check(fdt_property_string(fdt, "compatible", "bench,soc"),
+	      "fdt_property");
+	n = 1;
+
+	check(fdt_begin_node(fdt, "cpus"), "fdt_begin_node");
+	for (d = 0; d < 4; d++) {
+		snprintf(name, sizeof(name), "cpu@%d", d);
+		check(fdt_begin_node(fdt, name), "fdt_begin_node");
+		check(fdt_property_string(fdt, "device_type", "cpu"),
+		      "fdt_property");
+		check(fdt_property_u32(fdt, "reg", d), "fdt_property");
+		check(fdt_end_node(fdt), "fdt_end_node");
+	}
+	check(fdt_end_node(fdt), "fdt_end_node");
+	n += 5;
+
+	check(fdt_begin_node(fdt, "memory@80000000"), "fdt_begin_node");
+	check(fdt_property_string(fdt, "device_type", "memory"),
+	      "fdt_property");
+	reg[0] = cpu_to_fdt32(0);
+	reg[1] = cpu_to_fdt32(0x80000000);
+	reg[2] = cpu_to_fdt32(0);
+	reg[3] = cpu_to_fdt32(0x40000000);
+	check(fdt_property(fdt, "reg", reg, sizeof(reg)), "fdt_property");
+	check(fdt_end_node(fdt), "fdt_end_node");
+	n++;
+
+	check(fdt_begin_node(fdt, "soc"), "fdt_begin_node");
+	n++;
+	for (b = 0; b < num_buses && n < num_nodes; b++) {
+		snprintf(name, sizeof(name), "bus@%x", b);
+		check(fdt_begin_node(fdt, name), "fdt_begin_node");
+		check(fdt_property_string(fdt, "compatible", "simple-bus"),
+		      "fdt_property");
+		n++;
+		for (d = 0; d < DEVS_PER_BUS - 1 && n < num_nodes; d++) {
+			snprintf(name, sizeof(name), "dev@%x", d * 0x1000);
+			snprintf(compat, sizeof(compat), "vendor,dev%d",
+				 (b * DEVS_PER_BUS + d) % NUM_COMPATS);
+			snprintf(t->paths[t->num_devs++],
+				 sizeof(*t->paths), "/soc/bus@%x/%s", b, name);
+			check(fdt_begin_node(fdt, name), "fdt_begin_node");
+			check(fdt_property_string(fdt, "compatible", compat),
+			      "fdt_property");
+			reg[0] = cpu_to_fdt32(b);
+			reg[1] = cpu_to_fdt32(d * 0x1000);
+			reg[2] = cpu_to_fdt32(0);
+			reg[3] = cpu_to_fdt32(0x1000);
+			check(fdt_property(fdt, "reg", reg, sizeof(reg)),
+			      "fdt_property");
+			check(fdt_property_u32(fdt, "interrupts", d),
+			      "fdt_property");
+			check(fdt_property_string(fdt, "status", "okay"),
+			      "fdt_property");
+			n++;
+			if (!(d % 4) && n < num_nodes) {
+				check(fdt_begin_node(fdt, "port"),
+				      "fdt_begin_node");
+				check(fdt_property_u32(fdt, "reg", 0),
+				      "fdt_property");
+				check(fdt_end_node(fdt), "fdt_end_node");
+				n++;
+			}
+			check(fdt_end_node(fdt), "fdt_end_node");
+		}
+		check(fdt_end_node(fdt), "fdt_end_node");
+	}
+	check(fdt_end_node(fdt), "fdt_end_node");
+	check(fdt_end_node(fdt), "fdt_end_node");
+	check(fdt_finish(fdt), "fdt_finish");
+
+	t->num_nodes = n;
+	t->size = fdt_totalsize(fdt);
+}
+
+/* Fresh indexes for each blob, built on first use */
+static void init_indexes(const struct bench_tree *t)
+{
+	if (!t->indexed)
+		return;
+	check(fdt_strings_index_init(&strings_idx, strings_slots,
+				     sizeof(strings_slots)),
+	      "fdt_strings_index_init");
+	check(fdt_index_init(&node_idx, node_entries,
+			     t->num_nodes * sizeof(*node_entries),
+			     &strings_idx),
+	      "fdt_index_init");
+}
+
+static int path_offset(const struct bench_tree *t, const void *fdt,
+		       const char *path)
+{
+	if (t->indexed)
+		return fdt_index_path_offset(fdt, &node_idx, path);
+	return fdt_path_offset(fdt, path);
+}
+
+static int setprop(const struct bench_tree *t, void *fdt, int offs,
+		   const char *name, const void *val, int len)
+{
+	if (t->indexed)
+		return fdt_index_setprop(fdt, &node_idx, offs, name, val, len);
+	return fdt_setprop(fdt, offs, name, val, len);
+}
+
+static int del_node(const struct bench_tree *t, void *fdt, int offs)
+{
+	if (t->indexed)
+		return fdt_index_del_node(fdt, &node_idx, offs);
+	return fdt_del_node(fdt, offs);
+}
+
+static void bench_path_offset(const struct bench_tree *t)
+{
+	uint64_t start = now_ns();
+	uint64_t ns;
+	long ops = 0;
+
+	init_indexes(t);
+	do {
+		check(path_offset(t, t->fdt, t->paths[rnd() % t->num_devs]),
+		      "fdt_path_offset");
+		ops++;
+		ns = now_ns() - start;
+	} while (ns < MIN_NS && ops < MAX_OPS);
+
+	report(t, "fdt_path_offset", ops, ns, 0);
+}
+
+static void bench_by_compatible(const struct bench_tree *t)
+{
+	uint64_t start = now_ns();
+	uint64_t ns;
+	long ops = 0;
+	char compat[32];
+	int offs;
+
+	do {
+		snprintf(compat, sizeof(compat), "vendor,dev%u",
+			 rnd() % NUM_COMPATS);
+		/* One op finds every match, a walk over the whole tree */
+		offs = -1;
+		do {
+			offs = fdt_node_offset_by_compatible(t->fdt, offs,
+							     compat);
+		} while (offs >= 0);
+		ops++;
+		ns = now_ns() - start;
+	} while (ns < MIN_NS && ops < MAX_OPS);
+
+	report(t, "by_compatible (all matches)", ops, ns, 0);
+}
+
+/* Bytes libfdt moves to make room at, or close a gap at, offset */
+static uint64_t bytes_after(const void *fdt, int offset)
+{
+	return fdt_off_dt_strings(fdt) + fdt_size_dt_strings(fdt) -
+	       (fdt_off_dt_struct(fdt) + offset);
+}
+
+static void *open_copy(const struct bench_tree *t, int bufsize)
+{
+	void *buf = malloc(bufsize);
+
+	if (!buf)
+		check(-FDT_ERR_NOSPACE, "malloc");
+	check(fdt_open_into(t->fdt, buf, bufsize), "fdt_open_into");
+	return buf;
+}
+
+static void bench_setprop_grow(const struct bench_tree *t)
+{
+	int ops = t->num_devs < MAX_EDITS ? t->num_devs : MAX_EDITS;
+	int bufsize = t->size + ops * 64 + 4096;
+	void *fdt = open_copy(t, bufsize);
+	uint8_t val[256];
+	uint64_t bytes = 0;
+	uint64_t ns = 0;
+	uint64_t start;
+	int offs;
+	int len;
+	int n;
+
+	memset(val, 0xa5, sizeof(val));
+	init_indexes(t);
+	for (n = 0; n < ops; n++) {
+		offs = path_offset(t, fdt, t->paths[rnd() % t->num_devs]);
+		check(offs, "fdt_path_offset");
+		if (!fdt_getprop(fdt, offs, "bench,grow", &len))
+			len = 0;
+		if (len + 16 > (int)sizeof(val))
+			len = 0;
+
+		bytes += bytes_after(fdt, offs);
+		start = now_ns();
+		check(setprop(t, fdt, offs, "bench,grow", val, len + 16),
+		      "fdt_setprop");
+		ns += now_ns() - start;
+	}
+	free(fdt);
+
+	report(t, "fdt_setprop (grow by 16)", ops, ns, bytes);
+}
+
+/*
+ * Properties with names from a growing set, each new name is interned
+ * at the end of the strings block
+ */
+static void bench_setprop_names(const struct bench_tree *t)
+{
+	int ops = t->num_devs < MAX_EDITS ? t->num_devs : MAX_EDITS;
+	int bufsize = t->size + ops * 64 + 4096;
+	void *fdt = open_copy(t, bufsize);
+	fdt32_t val = cpu_to_fdt32(1);
+	uint64_t ns = 0;
+	uint64_t start;
+	char name[32];
+	int offs;
+	int n;
+
+	init_indexes(t);
+	for (n = 0; n < ops; n++) {
+		offs = path_offset(t, fdt, t->paths[rnd() % t->num_devs]);
+		check(offs, "fdt_path_offset");
+		snprintf(name, sizeof(name), "bench,name-%u", rnd() % ops);
+
+		start = now_ns();
+		check(setprop(t, fdt, offs, name, &val, sizeof(val)),
+		      "fdt_setprop");
+		ns += now_ns() - start;
+	}
+	free(fdt);
+
+	report(t, "fdt_setprop (new names)", ops, ns, 0);
+}
+
+static void bench_del_node(const struct bench_tree *t)
+{
+	int ops = t->num_devs / 2 < MAX_EDITS ? t->num_devs / 2 : MAX_EDITS;
+	void *fdt = open_copy(t, t->size);
+	uint64_t bytes = 0;
+	uint64_t ns = 0;
+	uint64_t start;
+	int offs;
+	int n;
+
+	init_indexes(t);
+	for (n = 0; n < ops; n++) {
+		/* Already deleted ones are just looked up again */
+		do {
+			offs = path_offset(t, fdt,
+					   t->paths[rnd() % t->num_devs]);
+		} while (offs == -FDT_ERR_NOTFOUND);
+		check(offs, "fdt_path_offset");
+
+		bytes += bytes_after(fdt, offs);
+		start = now_ns();
+		check(del_node(t, fdt, offs), "fdt_del_node");
+		ns += now_ns() - start;
+	}
+	free(fdt);
+
+	report(t, "fdt_del_node", ops, ns, bytes);
+}
+
+static void bench_open_into(const struct bench_tree *t)
+{
+	int bufsize = t->size * 2;
+	void *buf = malloc(bufsize);
+	uint64_t start = now_ns();
+	uint64_t ns;
+	long ops = 0;
+
+	if (!buf)
+		check(-FDT_ERR_NOSPACE, "malloc");
+	do {
+		check(fdt_open_into(t->fdt, buf, bufsize), "fdt_open_into");
+		ops++;
+		ns = now_ns() - start;
+	} while (ns < MIN_NS && ops < MAX_OPS);
+	free(buf);
+
+	report(t, "fdt_open_into", ops, ns, (uint64_t)t->size * ops);
+}
+
+static void bench_pack(const struct bench_tree *t)
+{
+	int bufsize = t->size * 2;
+	void *buf = malloc(bufsize);
+	uint64_t bytes = 0;
+	uint64_t ns = 0;
+	uint64_t start;
+	long ops = 0;
+	int offs;
+	int depth;
+	int size;
+	int n;
+	int r;
+
+	if (!buf)
+		check(-FDT_ERR_NOSPACE, "malloc");
+	do {
+		check(fdt_open_into(t->fdt, buf, bufsize), "fdt_open_into");
+		/*
+		 * Deleted properties add to the free space at the end of the
+		 * blob that fdt_pack() gives back
+		 */
+		for (offs = 0, depth = 0, n = 0; offs >= 0 && depth >= 0;
+		     offs = fdt_next_node(buf, offs, &depth), n++) {
+			if (n % (t->num_nodes / 16))
+				continue;
+			r = fdt_delprop(buf, offs, "status");
+			if (r != -FDT_ERR_NOTFOUND)
+				check(r, "fdt_delprop");
+		}
+		size = fdt_totalsize(buf);
+
+		start = now_ns();
+		check(fdt_pack(buf), "fdt_pack");
+		ns += now_ns() - start;
+		bytes += size - fdt_totalsize(buf);
+		ops++;
+	} while (ns < MIN_NS && ops < MAX_EDITS);
+	free(buf);
+
+	report(t, "fdt_pack (bytes freed)", ops, ns, bytes);
+}
+
+int main(int argc, char *argv[])
+{
+	static const int default_sizes[] = { 256, 1024, 4096, 16384, 65536 };
+	struct bench_tree t;
+	bool indexed = false;
+	int argn = 1;
+	int n;
+
+	if (argc > 1 && !strcmp(argv[1], "-i")) {
+		indexed = true;
+		argn++;
+	}
+
+	printf("%7s %9s %-28s %7s %11s %11s\n", "nodes", "bytes", "op",
+	       "ops", "ns/op", "bytes/op");
+
+	for (n = 0; ; n++) {
+		int num_nodes;
+
+		if (argn < argc) {
+			if (argn + n >= argc)
+				break;
+			num_nodes = atoi(argv[argn + n]);
+		} else {
+			if (n >= (int)(sizeof(default_sizes) /
+				       sizeof(default_sizes[0])))
+				break;
+			num_nodes = default_sizes[n];
+		}
+		if (num_nodes < 16)
+			num_nodes = 16;
+
+		memset(&t, 0, sizeof(t));
+		build_tree(&t, num_nodes);
+		t.indexed = indexed;
+		if (indexed) {
+			node_entries = malloc(t.num_nodes *
+					      sizeof(*node_entries));
+			if (!node_entries)
+				check(-FDT_ERR_NOSPACE, "malloc");
+		}
+
+		bench_path_offset(&t);
+		bench_by_compatible(&t);
+		bench_setprop_grow(&t);
+		bench_setprop_names(&t);
+		bench_del_node(&t);
+		bench_open_into(&t);
+		bench_pack(&t);
+
+		free(node_entries);
+		node_entries = NULL;
+		free(t.paths);
+		free(t.fdt);
+	}
+
+	return 0;
+}
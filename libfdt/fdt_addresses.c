@@ -0,0 +1,228 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+static int _fdt_cells_val(const void *val, int len, int min, int max,
+			  int dflt)
+{
+	uint32_t cells;
+
+	if (!val)
+		return len == -FDT_ERR_NOTFOUND ? dflt : len;
+	if (len != sizeof(fdt32_t))
+		return -FDT_ERR_BADNCELLS;
+
+	cells = fdt32_to_cpu(*(const fdt32_t *)val);
+	if (cells < min || cells > max)
+		return -FDT_ERR_BADNCELLS;
+	return cells;
+}
+
+int fdt_address_cells_val(const void *val, int len)
+{
+	return _fdt_cells_val(val, len, 1, FDT_MAX_ADDR_NCELLS, 2);
+}
+
+int fdt_size_cells_val(const void *val, int len)
+{
+	return _fdt_cells_val(val, len, 0, FDT_MAX_NCELLS, 1);
+}
+
+int fdt_address_cells(const void *fdt, int nodeoffset)
+{
+	const void *val;
+	int len;
+
+	val = fdt_getprop(fdt, nodeoffset, "#address-cells", &len);
+	return fdt_address_cells_val(val, len);
+}
+
+int fdt_size_cells(const void *fdt, int nodeoffset)
+{
+	const void *val;
+	int len;
+
+	val = fdt_getprop(fdt, nodeoffset, "#size-cells", &len);
+	return fdt_size_cells_val(val, len);
+}
+
+int fdt_cells_get(const void *fdt, int nodeoffset, struct fdt_cells *cells)
+{
+	int addr_cells, size_cells;
+
+	if (cells->nodeoffset == nodeoffset)
+		return 0;
+
+	addr_cells = fdt_address_cells(fdt, nodeoffset);
+	if (addr_cells < 0)
+		return addr_cells;
+	size_cells = fdt_size_cells(fdt, nodeoffset);
+	if (size_cells < 0)
+		return size_cells;
+
+	cells->nodeoffset = nodeoffset;
+	cells->addr_cells = addr_cells;
+	cells->size_cells = size_cells;
+	return 0;
+}
+
+/* Sets up the cells of an iterator, returns the number of entries */
+static int _fdt_cells_iter_init(const void *val, int len, int stride,
+				const fdt32_t **cell, const fdt32_t **end)
+{
+	int size = stride * sizeof(fdt32_t);
+
+	if (len < 0 || len % size)
+		return -FDT_ERR_BADVALUE;
+
+	*cell = val;
+	*end = *cell + len / sizeof(fdt32_t);
+	return len / size;
+}
+
+int fdt_reg_iter_init(struct fdt_reg_iter *iter, const void *val, int len,
+		      int addr_cells, int size_cells)
+{
+	int num;
+
+	if (addr_cells < 1 || addr_cells > FDT_MAX_NCELLS ||
+	    size_cells < 0 || size_cells > FDT_MAX_NCELLS)
+		return -FDT_ERR_BADNCELLS;
+
+	num = _fdt_cells_iter_init(val, len, addr_cells + size_cells,
+				   &iter->cell, &iter->end);
+	if (num < 0)
+		return num;
+
+	iter->num = num;
+	iter->addr_cells = addr_cells;
+	iter->size_cells = size_cells;
+	return 0;
+}
+
+int fdt_ranges_iter_init(struct fdt_ranges_iter *iter, const void *val,
+			 int len, int child_cells, int parent_cells,
+			 int size_cells)
+{
+	int num;
+
+	if (child_cells < 1 || child_cells > FDT_MAX_ADDR_NCELLS ||
+	    parent_cells < 1 || parent_cells > FDT_MAX_ADDR_NCELLS ||
+	    size_cells < 0 || size_cells > FDT_MAX_NCELLS)
+		return -FDT_ERR_BADNCELLS;
+
+	num = _fdt_cells_iter_init(val, len,
+				   child_cells + parent_cells + size_cells,
+				   &iter->cell, &iter->end);
+	if (num < 0)
+		return num;
+
+	iter->num = num;
+	iter->child_cells = child_cells;
+	iter->parent_cells = parent_cells;
+	iter->size_cells = size_cells;
+	return 0;
+}
+
+/* Encodes val in ncells cells, -FDT_ERR_BADVALUE if it doesn't fit */
+static int _fdt_write_cells(fdt32_t *cell, int ncells, uint64_t val)
+{
+	switch (ncells) {
+	case 0:
+		return val ? -FDT_ERR_BADVALUE : 0;
+	case 1:
+		if (val > UINT32_MAX)
+			return -FDT_ERR_BADVALUE;
+		cell[0] = cpu_to_fdt32(val);
+		return 0;
+	case 2:
+		cell[0] = cpu_to_fdt32(val >> 32);
+		cell[1] = cpu_to_fdt32(val);
+		return 0;
+	default:
+		return -FDT_ERR_BADNCELLS;
+	}
+}
+
+int fdt_reg_encode(void *buf, int bufsize, int addr_cells, int size_cells,
+		   const struct fdt_reg *regs, int num)
+{
+	fdt32_t *cell = buf;
+	int len;
+	int err;
+	int n;
+
+	if (addr_cells < 1 || addr_cells > FDT_MAX_NCELLS ||
+	    size_cells < 0 || size_cells > FDT_MAX_NCELLS)
+		return -FDT_ERR_BADNCELLS;
+
+	len = fdt_reg_size(addr_cells, size_cells, num);
+	if (num < 0 || len > bufsize)
+		return -FDT_ERR_NOSPACE;
+
+	for (n = 0; n < num; n++) {
+		err = _fdt_write_cells(cell, addr_cells, regs[n].address);
+		if (err)
+			return err;
+		cell += addr_cells;
+		err = _fdt_write_cells(cell, size_cells, regs[n].size);
+		if (err)
+			return err;
+		cell += size_cells;
+	}
+
+	return len;
+}
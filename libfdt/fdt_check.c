@@ -0,0 +1,383 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+/* Header fields of v17, v16 blobs have no size_dt_struct */
+#define FDT_V16_HEADER_SIZE	(sizeof(struct fdt_header) - sizeof(fdt32_t))
+
+/* True if [off, off + len) is within size, without overflowing */
+static int _fdt_range_ok(uint32_t off, uint32_t len, uint32_t size)
+{
+	return off <= size && len <= size - off;
+}
+
+static int _fdt_check_blocks(const void *fdt, size_t bufsize,
+			     uint32_t *struct_size)
+{
+	uint32_t totalsize = fdt_totalsize(fdt);
+	uint32_t hdrsize;
+	uint32_t off;
+	uint64_t size;
+
+	hdrsize = fdt_version(fdt) >= 17 ? sizeof(struct fdt_header)
+					 : FDT_V16_HEADER_SIZE;
+	if (totalsize < hdrsize || totalsize > bufsize)
+		return -FDT_ERR_TRUNCATED;
+
+	if (fdt_off_dt_struct(fdt) % FDT_TAGSIZE ||
+	    fdt_off_mem_rsvmap(fdt) % sizeof(uint64_t))
+		return -FDT_ERR_BADLAYOUT;
+
+	if (fdt_off_dt_struct(fdt) < hdrsize ||
+	    fdt_off_mem_rsvmap(fdt) < hdrsize ||
+	    fdt_off_dt_strings(fdt) < hdrsize)
+		return -FDT_ERR_BADLAYOUT;
+
+	if (fdt_version(fdt) >= 17)
+		*struct_size = fdt_size_dt_struct(fdt);
+	else if (fdt_off_dt_struct(fdt) <= totalsize)
+		*struct_size = totalsize - fdt_off_dt_struct(fdt);
+	else
+		return -FDT_ERR_TRUNCATED;
+
+	if (!_fdt_range_ok(fdt_off_dt_struct(fdt), *struct_size, totalsize) ||
+	    !_fdt_range_ok(fdt_off_dt_strings(fdt), fdt_size_dt_strings(fdt),
+			   totalsize))
+		return -FDT_ERR_TRUNCATED;
+
+	/* The reservations run up to the terminating entry */
+	off = fdt_off_mem_rsvmap(fdt);
+	do {
+		if (!_fdt_range_ok(off, sizeof(struct fdt_reserve_entry),
+				   totalsize))
+			return -FDT_ERR_TRUNCATED;
+		size = fdt64_to_cpu(((const struct fdt_reserve_entry *)
+				     ((const char *)fdt + off))->size);
+		off += sizeof(struct fdt_reserve_entry);
+	} while (size);
+
+	return 0;
+}
+
+/* True if the string at stroffset is terminated within the strings */
+static int _fdt_string_ok(const void *fdt, uint32_t stroffset)
+{
+	uint32_t size = fdt_size_dt_strings(fdt);
+	const char *s = (const char *)fdt + fdt_off_dt_strings(fdt);
+
+	return stroffset < size &&
+	       memchr(s + stroffset, '\0', size - stroffset) != NULL;
+}
+
+int fdt_check_full(const void *fdt, size_t bufsize)
+{
+	const char *base;
+	uint32_t struct_size;
+	uint32_t offset = 0;
+	uint32_t len;
+	int depth = 0;
+	int nodes = 0;
+	int in_props = 0;
+	int err;
+
+	if (bufsize < FDT_V16_HEADER_SIZE)
+		return -FDT_ERR_TRUNCATED;
+	if (fdt_magic(fdt) != FDT_MAGIC)
+		return fdt_magic(fdt) == FDT_SW_MAGIC ? -FDT_ERR_BADSTATE
+						      : -FDT_ERR_BADMAGIC;
+	FDT_CHECK_HEADER(fdt);
+
+	err = _fdt_check_blocks(fdt, bufsize, &struct_size);
+	if (err)
+		return err;
+
+	base = _fdt_offset_ptr(fdt, 0);
+	for (;;) {
+		const struct fdt_property *prop;
+		const char *p;
+		uint32_t tag;
+
+		if (!_fdt_range_ok(offset, FDT_TAGSIZE, struct_size))
+			return -FDT_ERR_TRUNCATED;
+		tag = fdt32_to_cpu(*(const fdt32_t *)(base + offset));
+
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			/* A single root node */
+			if (!depth && nodes)
+				return -FDT_ERR_BADSTRUCTURE;
+			p = base + offset + FDT_TAGSIZE;
+			p = memchr(p, '\0', struct_size - offset - FDT_TAGSIZE);
+			if (!p)
+				return -FDT_ERR_TRUNCATED;
+			len = p + 1 - (base + offset);
+			depth++;
+			nodes++;
+			in_props = 1;
+			break;
+
+		case FDT_PROP:
+			/* Properties come before the subnodes of a node */
+			if (!in_props)
+				return -FDT_ERR_BADSTRUCTURE;
+			if (!_fdt_range_ok(offset, sizeof(*prop), struct_size))
+				return -FDT_ERR_TRUNCATED;
+			prop = (const struct fdt_property *)(base + offset);
+			len = fdt32_to_cpu(prop->len);
+			if (!_fdt_range_ok(offset + sizeof(*prop), len,
+					   struct_size))
+				return -FDT_ERR_TRUNCATED;
+			if (!_fdt_string_ok(fdt, fdt32_to_cpu(prop->nameoff)))
+				return -FDT_ERR_BADSTRUCTURE;
+			len += sizeof(*prop);
+			break;
+
+		case FDT_END_NODE:
+			if (!depth)
+				return -FDT_ERR_BADSTRUCTURE;
+			depth--;
+			in_props = 0;
+			len = FDT_TAGSIZE;
+			break;
+
+		case FDT_NOP:
+			len = FDT_TAGSIZE;
+			break;
+
+		case FDT_END:
+			if (depth || !nodes)
+				return -FDT_ERR_BADSTRUCTURE;
+			return 0;
+
+		default:
+			return -FDT_ERR_BADSTRUCTURE;
+		}
+
+		/* The padding may run up to the end of the block, no further */
+		offset += FDT_TAGALIGN(len);
+		if (offset > struct_size)
+			return -FDT_ERR_TRUNCATED;
+	}
+}
+
+uint32_t fdt_next_tag_unchecked(const void *fdt, int offset, int *nextoffset)
+{
+	const char *p = _fdt_offset_ptr(fdt, offset);
+	uint32_t tag = fdt32_to_cpu(*(const fdt32_t *)p);
+	int len;
+
+	switch (tag) {
+	case FDT_BEGIN_NODE:
+		len = FDT_TAGSIZE + strlen(p + FDT_TAGSIZE) + 1;
+		break;
+	case FDT_PROP:
+		len = sizeof(struct fdt_property) +
+		      fdt32_to_cpu(((const struct fdt_property *)p)->len);
+		break;
+	default:
+		len = FDT_TAGSIZE;
+		break;
+	}
+
+	*nextoffset = offset + FDT_TAGALIGN(len);
+	return tag;
+}
+
+int fdt_next_node_unchecked(const void *fdt, int offset, int *depth)
+{
+	uint32_t tag;
+	int nextoffset;
+
+	/* Past the node itself, or from the root node with a negative one */
+	if (offset >= 0)
+		fdt_next_tag_unchecked(fdt, offset, &offset);
+	else
+		offset = 0;
+
+	for (;;) {
+		tag = fdt_next_tag_unchecked(fdt, offset, &nextoffset);
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			if (depth)
+				(*depth)++;
+			return offset;
+		case FDT_END_NODE:
+			if (depth && --(*depth) < 0)
+				return -FDT_ERR_NOTFOUND;
+			break;
+		case FDT_END:
+			return -FDT_ERR_NOTFOUND;
+		default:
+			break;
+		}
+		offset = nextoffset;
+	}
+}
+
+static int _fdt_nextprop_unchecked(const void *fdt, int offset)
+{
+	uint32_t tag;
+	int nextoffset;
+
+	for (;;) {
+		tag = fdt_next_tag_unchecked(fdt, offset, &nextoffset);
+		if (tag == FDT_PROP)
+			return offset;
+		if (tag != FDT_NOP)
+			return -FDT_ERR_NOTFOUND;
+		offset = nextoffset;
+	}
+}
+
+int fdt_first_property_offset_unchecked(const void *fdt, int nodeoffset)
+{
+	fdt_next_tag_unchecked(fdt, nodeoffset, &nodeoffset);
+	return _fdt_nextprop_unchecked(fdt, nodeoffset);
+}
+
+int fdt_next_property_offset_unchecked(const void *fdt, int offset)
+{
+	fdt_next_tag_unchecked(fdt, offset, &offset);
+	return _fdt_nextprop_unchecked(fdt, offset);
+}
+
+const void *fdt_getprop_by_offset_unchecked(const void *fdt, int offset,
+					    const char **namep, int *lenp)
+{
+	const struct fdt_property *prop = _fdt_offset_ptr(fdt, offset);
+
+	if (namep)
+		*namep = fdt_string(fdt, fdt32_to_cpu(prop->nameoff));
+	if (lenp)
+		*lenp = fdt32_to_cpu(prop->len);
+	return prop->data;
+}
+
+const void *fdt_getprop_unchecked(const void *fdt, int nodeoffset,
+				  const char *name, int *lenp)
+{
+	const char *pname;
+	const void *val;
+	int offset;
+
+	for (offset = fdt_first_property_offset_unchecked(fdt, nodeoffset);
+	     offset >= 0;
+	     offset = fdt_next_property_offset_unchecked(fdt, offset)) {
+		val = fdt_getprop_by_offset_unchecked(fdt, offset, &pname,
+						      lenp);
+		if (!strcmp(pname, name))
+			return val;
+	}
+
+	if (lenp)
+		*lenp = -FDT_ERR_NOTFOUND;
+	return NULL;
+}
+
+int fdt_getprops_unchecked(const void *fdt, int nodeoffset,
+			   const char *const *names, int num,
+			   const void **vals, int *lens)
+{
+	const char *name;
+	const void *val;
+	int found = 0;
+	int offset;
+	int len;
+
+	_fdt_getprops_init(num, vals, lens);
+
+	for (offset = fdt_first_property_offset_unchecked(fdt, nodeoffset);
+	     offset >= 0 && found < num;
+	     offset = fdt_next_property_offset_unchecked(fdt, offset)) {
+		val = fdt_getprop_by_offset_unchecked(fdt, offset, &name,
+						      &len);
+		found += _fdt_getprops_match(name, val, len, names, num,
+					     vals, lens);
+	}
+
+	return found;
+}
+
+const char *fdt_get_name_unchecked(const void *fdt, int nodeoffset)
+{
+	const struct fdt_node_header *nh = _fdt_offset_ptr(fdt, nodeoffset);
+
+	return nh->name;
+}
+
+int fdt_subnode_offset_unchecked(const void *fdt, int parentoffset,
+				 const char *name)
+{
+	int len = strlen(name);
+	const char *p;
+	int depth = 0;
+	int offset;
+
+	for (offset = fdt_next_node_unchecked(fdt, parentoffset, &depth);
+	     offset >= 0 && depth > 0;
+	     offset = fdt_next_node_unchecked(fdt, offset, &depth)) {
+		if (depth != 1)
+			continue;
+		/* A name without a unit address matches any unit address */
+		p = fdt_get_name_unchecked(fdt, offset);
+		if (!memcmp(p, name, len) &&
+		    (p[len] == '\0' ||
+		     (p[len] == '@' && !memchr(name, '@', len))))
+			return offset;
+	}
+
+	return -FDT_ERR_NOTFOUND;
+}
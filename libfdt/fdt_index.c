@@ -0,0 +1,316 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+enum {
+	FDT_INDEX_STALE,
+	FDT_INDEX_BUILT,
+	FDT_INDEX_FAILED,
+};
+
+/* Hash of the node name up to the unit address */
+uint32_t _fdt_index_name_hash(const char *name, int len)
+{
+	const char *at = memchr(name, '@', len);
+
+	return fdt_fnv1a(name, at ? at - name : len);
+}
+
+static uint32_t _fdt_prop_phandle(const void *fdt, int offset)
+{
+	const struct fdt_property *prop = _fdt_offset_ptr(fdt, offset);
+	const char *name = fdt_string(fdt, fdt32_to_cpu(prop->nameoff));
+
+	if (fdt32_to_cpu(prop->len) != sizeof(fdt32_t))
+		return 0;
+	if (strcmp(name, "phandle") && strcmp(name, "linux,phandle"))
+		return 0;
+	return fdt32_to_cpu(*(const fdt32_t *)prop->data);
+}
+
+/* All nodes in structure block order, in one pass over the tags */
+static int _fdt_index_build(const void *fdt, struct fdt_index *idx)
+{
+	struct fdt_index_entry *e;
+	const char *name;
+	int offset = 0;
+	int nextoffset;
+	int parent = -1;
+	int depth = -1;
+	uint32_t tag;
+
+	idx->count = 0;
+	do {
+		tag = fdt_next_tag(fdt, offset, &nextoffset);
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			if (idx->count >= idx->max)
+				return -FDT_ERR_NOSPACE;
+			e = idx->entries + idx->count;
+			name = (const char *)_fdt_offset_ptr(fdt, offset) +
+			       FDT_TAGSIZE;
+			e->offset = offset;
+			e->parent = parent;
+			e->next = -1;
+			e->depth = ++depth;
+			e->name_hash = _fdt_index_name_hash(name,
+							    strlen(name));
+			e->phandle = 0;
+			parent = idx->count++;
+			break;
+
+		case FDT_PROP:
+			if (parent < 0)
+				return -FDT_ERR_BADSTRUCTURE;
+			e = idx->entries + parent;
+			if (!e->phandle)
+				e->phandle = _fdt_prop_phandle(fdt, offset);
+			break;
+
+		case FDT_END_NODE:
+			if (parent < 0)
+				return -FDT_ERR_BADSTRUCTURE;
+			e = idx->entries + parent;
+			e->next = idx->count;
+			parent = e->parent;
+			depth--;
+			break;
+
+		case FDT_END:
+			if (nextoffset < 0)
+				return nextoffset;
+			if (parent >= 0)
+				return -FDT_ERR_BADSTRUCTURE;
+			break;
+		}
+		offset = nextoffset;
+	} while (tag != FDT_END);
+
+	return 0;
+}
+
+struct fdt_index *_fdt_index_get(const void *fdt, struct fdt_index *idx)
+{
+	if (!idx)
+		return NULL;
+
+	/* Most edits not done through the index change the size */
+	if (idx->struct_size != (int)fdt_size_dt_struct(fdt))
+		idx->state = FDT_INDEX_STALE;
+
+	if (idx->state == FDT_INDEX_STALE) {
+		idx->struct_size = fdt_size_dt_struct(fdt);
+		if (_fdt_index_build(fdt, idx))
+			idx->state = FDT_INDEX_FAILED;
+		else
+			idx->state = FDT_INDEX_BUILT;
+	}
+
+	if (idx->state != FDT_INDEX_BUILT)
+		return NULL;
+	return idx;
+}
+
+struct fdt_index_entry *_fdt_index_find(struct fdt_index *idx, int offset)
+{
+	int lo = 0;
+	int hi = idx->count;
+	int mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (idx->entries[mid].offset == offset)
+			return idx->entries + mid;
+		if (idx->entries[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+/* Only a built index is patched, a stale one is rebuilt on next use */
+static struct fdt_index *_fdt_index_built(struct fdt_index *idx)
+{
+	if (!idx || idx->state != FDT_INDEX_BUILT)
+		return NULL;
+	return idx;
+}
+
+void _fdt_index_splice(struct fdt_index *idx, int offset, int oldlen,
+		       int newlen)
+{
+	int delta = newlen - oldlen;
+	int n;
+
+	idx = _fdt_index_built(idx);
+	if (!idx)
+		return;
+
+	for (n = idx->count - 1;
+	     n >= 0 && idx->entries[n].offset >= offset + oldlen; n--)
+		idx->entries[n].offset += delta;
+	idx->struct_size += delta;
+}
+
+void _fdt_index_add(struct fdt_index *idx, int parentoffset, int offset,
+		    const char *name, int namelen)
+{
+	struct fdt_index_entry *parent;
+	struct fdt_index_entry *e;
+	int pos;
+	int n;
+
+	idx = _fdt_index_built(idx);
+	if (!idx)
+		return;
+
+	parent = _fdt_index_find(idx, parentoffset);
+	if (!parent || idx->count >= idx->max) {
+		idx->state = FDT_INDEX_STALE;
+		return;
+	}
+
+	/* New nodes go first among the subnodes of their parent */
+	pos = parent - idx->entries + 1;
+	memmove(idx->entries + pos + 1, idx->entries + pos,
+		(idx->count - pos) * sizeof(*e));
+	idx->count++;
+
+	for (n = 0; n < idx->count; n++) {
+		e = idx->entries + n;
+		if (e->parent >= pos)
+			e->parent++;
+		if (e->next >= pos)
+			e->next++;
+	}
+
+	e = idx->entries + pos;
+	e->offset = offset;
+	e->parent = pos - 1;
+	e->next = pos + 1;
+	e->depth = idx->entries[pos - 1].depth + 1;
+	e->name_hash = _fdt_index_name_hash(name, namelen);
+	e->phandle = 0;
+}
+
+void _fdt_index_remove(struct fdt_index *idx, int nodeoffset)
+{
+	struct fdt_index_entry *e;
+	int pos;
+	int num;
+	int n;
+
+	idx = _fdt_index_built(idx);
+	if (!idx)
+		return;
+
+	e = _fdt_index_find(idx, nodeoffset);
+	if (!e) {
+		idx->state = FDT_INDEX_STALE;
+		return;
+	}
+
+	/* The node and its subtree */
+	pos = e - idx->entries;
+	num = e->next - pos;
+	memmove(e, e + num, (idx->count - pos - num) * sizeof(*e));
+	idx->count -= num;
+
+	for (n = 0; n < idx->count; n++) {
+		e = idx->entries + n;
+		if (e->parent >= pos)
+			e->parent -= num;
+		if (e->next > pos)
+			e->next -= num;
+	}
+}
+
+void _fdt_index_rename(struct fdt_index *idx, int nodeoffset,
+		       const char *name, int namelen)
+{
+	struct fdt_index_entry *e;
+
+	idx = _fdt_index_built(idx);
+	if (!idx)
+		return;
+
+	e = _fdt_index_find(idx, nodeoffset);
+	if (e)
+		e->name_hash = _fdt_index_name_hash(name, namelen);
+	else
+		idx->state = FDT_INDEX_STALE;
+}
+
+int fdt_index_init(struct fdt_index *idx, void *buf, int bufsize,
+		   struct fdt_strings_index *strings)
+{
+	if (bufsize < (int)sizeof(struct fdt_index_entry))
+		return -FDT_ERR_NOSPACE;
+
+	idx->entries = buf;
+	idx->max = bufsize / sizeof(struct fdt_index_entry);
+	idx->strings = strings;
+	fdt_index_invalidate(idx);
+	return 0;
+}
+
+void fdt_index_invalidate(struct fdt_index *idx)
+{
+	idx->count = 0;
+	idx->struct_size = -1;
+	idx->state = FDT_INDEX_STALE;
+}
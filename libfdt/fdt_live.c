@@ -0,0 +1,652 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+#define FDT_LIVE_ALIGN		8
+#define FDT_LIVE_MIN_NAMES	16
+#define FDT_LIVE_MAX_NAMES	1024
+
+void *_fdt_live_alloc(struct fdt_live_tree *tree, int len)
+{
+	int size = FDT_ALIGN(len, FDT_LIVE_ALIGN);
+	void *p;
+
+	if (len < 0 || size > tree->size - tree->used)
+		return NULL;
+	p = tree->arena + tree->used;
+	tree->used += size;
+	return p;
+}
+
+/*
+ * Returns the record shared by all properties with this name, str is
+ * copied into the arena unless it's in the source blob.
+ */
+struct fdt_live_name *_fdt_live_name(struct fdt_live_tree *tree,
+				     const char *str, int copy)
+{
+	int len = strlen(str);
+	struct fdt_live_name **bucket;
+	struct fdt_live_name *name;
+	char *s;
+
+	bucket = &tree->names[fdt_fnv1a(str, len) & tree->names_mask];
+	for (name = *bucket; name; name = name->next)
+		if (name->len == len && !memcmp(name->str, str, len))
+			return name;
+
+	name = _fdt_live_alloc(tree, sizeof(*name));
+	if (!name)
+		return NULL;
+	if (copy) {
+		s = _fdt_live_alloc(tree, len + 1);
+		if (!s)
+			return NULL;
+		memcpy(s, str, len + 1);
+		str = s;
+	}
+	name->str = str;
+	name->len = len;
+	name->nameoff = -1;
+	name->next = *bucket;
+	*bucket = name;
+	return name;
+}
+
+/* Children and properties are prepended while unflattening */
+static void _fdt_live_reverse(struct fdt_live_node *node)
+{
+	struct fdt_live_node *child = node->child;
+	struct fdt_live_prop *prop = node->props;
+
+	node->child = NULL;
+	while (child) {
+		struct fdt_live_node *next = child->sibling;
+
+		child->sibling = node->child;
+		node->child = child;
+		child = next;
+	}
+
+	node->props = NULL;
+	while (prop) {
+		struct fdt_live_prop *next = prop->next;
+
+		prop->next = node->props;
+		node->props = prop;
+		prop = next;
+	}
+}
+
+static int _fdt_live_unflatten_rsv(const void *fdt, struct fdt_live_tree *tree)
+{
+	struct fdt_live_rsv **tail = &tree->rsv;
+	int n = fdt_num_mem_rsv(fdt);
+	int i;
+
+	for (i = 0; i < n; i++) {
+		struct fdt_live_rsv *rsv = _fdt_live_alloc(tree, sizeof(*rsv));
+
+		if (!rsv)
+			return -FDT_ERR_NOSPACE;
+		fdt_get_mem_rsv(fdt, i, &rsv->address, &rsv->size);
+		rsv->next = NULL;
+		*tail = rsv;
+		tail = &rsv->next;
+	}
+	return 0;
+}
+
+int _fdt_live_unflatten_nodes(struct fdt_live_tree *tree, const void *fdt,
+			      struct fdt_live_node **rootp)
+{
+	struct fdt_live_node *root = NULL;
+	struct fdt_live_node *cur = NULL;
+	struct fdt_live_node *node;
+	struct fdt_live_prop *prop;
+	const struct fdt_property *fprop;
+	int offset = 0;
+	int nextoffset;
+	uint32_t tag;
+
+	do {
+		tag = fdt_next_tag(fdt, offset, &nextoffset);
+		if (nextoffset < 0)
+			return nextoffset;
+
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			if (!cur && root)
+				return -FDT_ERR_BADSTRUCTURE;
+			node = _fdt_live_alloc(tree, sizeof(*node));
+			if (!node)
+				return -FDT_ERR_NOSPACE;
+			memset(node, 0, sizeof(*node));
+			node->name = fdt_get_name(fdt, offset, &node->namelen);
+			if (!node->name)
+				return node->namelen;
+			node->parent = cur;
+			if (cur) {
+				node->sibling = cur->child;
+				cur->child = node;
+			} else {
+				root = node;
+			}
+			cur = node;
+			break;
+
+		case FDT_PROP:
+			if (!cur)
+				return -FDT_ERR_BADSTRUCTURE;
+			fprop = _fdt_offset_ptr(fdt, offset);
+			prop = _fdt_live_alloc(tree, sizeof(*prop));
+			if (!prop)
+				return -FDT_ERR_NOSPACE;
+			prop->name = _fdt_live_name(tree,
+				fdt_string(fdt, fdt32_to_cpu(fprop->nameoff)),
+				0);
+			if (!prop->name)
+				return -FDT_ERR_NOSPACE;
+			prop->val = fprop->data;
+			prop->len = fdt32_to_cpu(fprop->len);
+			prop->next = cur->props;
+			cur->props = prop;
+			break;
+
+		case FDT_END_NODE:
+			if (!cur)
+				return -FDT_ERR_BADSTRUCTURE;
+			_fdt_live_reverse(cur);
+			cur = cur->parent;
+			break;
+
+		case FDT_NOP:
+			break;
+
+		case FDT_END:
+			if (cur || !root)
+				return -FDT_ERR_BADSTRUCTURE;
+			break;
+
+		default:
+			return -FDT_ERR_BADSTRUCTURE;
+		}
+		offset = nextoffset;
+	} while (tag != FDT_END);
+
+	*rootp = root;
+	return 0;
+}
+
+int fdt_live_unflatten(const void *fdt, struct fdt_live_tree *tree,
+		       void *buf, int bufsize)
+{
+	uint32_t nbuckets;
+	int err;
+
+	FDT_CHECK_HEADER(fdt);
+
+	memset(tree, 0, sizeof(*tree));
+	tree->arena = buf;
+	tree->size = bufsize;
+	tree->boot_cpuid_phys = fdt_boot_cpuid_phys(fdt);
+
+	/* About one name per eight bytes of strings block */
+	nbuckets = FDT_LIVE_MIN_NAMES;
+	while (nbuckets < FDT_LIVE_MAX_NAMES &&
+	       nbuckets < fdt_size_dt_strings(fdt) / 8)
+		nbuckets *= 2;
+	tree->names = _fdt_live_alloc(tree, nbuckets * sizeof(*tree->names));
+	if (!tree->names)
+		return -FDT_ERR_NOSPACE;
+	memset(tree->names, 0, nbuckets * sizeof(*tree->names));
+	tree->names_mask = nbuckets - 1;
+
+	err = _fdt_live_unflatten_rsv(fdt, tree);
+	if (err)
+		return err;
+
+	return _fdt_live_unflatten_nodes(tree, fdt, &tree->root);
+}
+
+static int _fdt_live_nodename_eq(const struct fdt_live_node *node,
+				 const char *s, int len)
+{
+	if (node->namelen < len || memcmp(node->name, s, len) != 0)
+		return 0;
+
+	if (node->namelen == len)
+		return 1;
+	else if (!memchr(s, '@', len) && node->name[len] == '@')
+		return 1;
+	else
+		return 0;
+}
+
+struct fdt_live_node *_fdt_live_subnode_namelen(
+	const struct fdt_live_node *parent, const char *name, int namelen)
+{
+	struct fdt_live_node *child;
+
+	for (child = parent->child; child; child = child->sibling)
+		if (_fdt_live_nodename_eq(child, name, namelen))
+			return child;
+	return NULL;
+}
+
+struct fdt_live_node *fdt_live_subnode(const struct fdt_live_node *parent,
+				       const char *name)
+{
+	return _fdt_live_subnode_namelen(parent, name, strlen(name));
+}
+
+struct fdt_live_node *_fdt_live_path_namelen(struct fdt_live_node *root,
+					    const char *path, int len)
+{
+	struct fdt_live_node *node = root;
+	const char *end = path + len;
+	const char *p = path;
+	const char *q;
+
+	if (len < 1 || *p != '/')
+		return NULL;
+
+	while (p < end && node) {
+		while (p < end && *p == '/')
+			p++;
+		if (p == end)
+			break;
+		q = memchr(p, '/', end - p);
+		if (!q)
+			q = end;
+		node = _fdt_live_subnode_namelen(node, p, q - p);
+		p = q;
+	}
+	return node;
+}
+
+struct fdt_live_node *fdt_live_path(const struct fdt_live_tree *tree,
+				    const char *path)
+{
+	return _fdt_live_path_namelen(tree->root, path, strlen(path));
+}
+
+struct fdt_live_node *fdt_live_next_node(const struct fdt_live_node *node)
+{
+	if (node->child)
+		return node->child;
+
+	while (node) {
+		if (node->sibling)
+			return node->sibling;
+		node = node->parent;
+	}
+	return NULL;
+}
+
+struct fdt_live_prop *_fdt_live_get_property(
+	const struct fdt_live_node *node, const char *name)
+{
+	struct fdt_live_prop *prop;
+	int len = strlen(name);
+
+	for (prop = node->props; prop; prop = prop->next)
+		if (prop->name->len == len &&
+		    !memcmp(prop->name->str, name, len))
+			return prop;
+	return NULL;
+}
+
+const void *fdt_live_getprop(const struct fdt_live_node *node,
+			     const char *name, int *lenp)
+{
+	struct fdt_live_prop *prop = _fdt_live_get_property(node, name);
+
+	if (!prop) {
+		if (lenp)
+			*lenp = -FDT_ERR_NOTFOUND;
+		return NULL;
+	}
+	if (lenp)
+		*lenp = prop->len;
+	return prop->val;
+}
+
+int fdt_live_address_cells(const struct fdt_live_node *node)
+{
+	const void *val;
+	int len;
+
+	val = fdt_live_getprop(node, "#address-cells", &len);
+	return fdt_address_cells_val(val, len);
+}
+
+int fdt_live_size_cells(const struct fdt_live_node *node)
+{
+	const void *val;
+	int len;
+
+	val = fdt_live_getprop(node, "#size-cells", &len);
+	return fdt_size_cells_val(val, len);
+}
+
+int fdt_live_setprop_placeholder(struct fdt_live_tree *tree,
+				 struct fdt_live_node *node, const char *name,
+				 int len, void **valp)
+{
+	struct fdt_live_prop *prop = _fdt_live_get_property(node, name);
+	void *val;
+
+	if (!prop) {
+		prop = _fdt_live_alloc(tree, sizeof(*prop));
+		if (!prop)
+			return -FDT_ERR_NOSPACE;
+		prop->name = _fdt_live_name(tree, name, 1);
+		if (!prop->name)
+			return -FDT_ERR_NOSPACE;
+		prop->val = NULL;
+		prop->len = 0;
+		/* New properties go first, as with fdt_setprop() */
+		prop->next = node->props;
+		node->props = prop;
+	}
+
+	val = _fdt_live_alloc(tree, len);
+	if (!val)
+		return -FDT_ERR_NOSPACE;
+	prop->val = val;
+	prop->len = len;
+	*valp = val;
+	return 0;
+}
+
+int fdt_live_setprop(struct fdt_live_tree *tree, struct fdt_live_node *node,
+		     const char *name, const void *val, int len)
+{
+	void *p;
+	int err;
+
+	err = fdt_live_setprop_placeholder(tree, node, name, len, &p);
+	if (err)
+		return err;
+	memcpy(p, val, len);
+	return 0;
+}
+
+int fdt_live_delprop(struct fdt_live_node *node, const char *name)
+{
+	struct fdt_live_prop **pp;
+	int len = strlen(name);
+
+	for (pp = &node->props; *pp; pp = &(*pp)->next) {
+		if ((*pp)->name->len == len &&
+		    !memcmp((*pp)->name->str, name, len)) {
+			*pp = (*pp)->next;
+			return 0;
+		}
+	}
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdt_live_add_subnode(struct fdt_live_tree *tree,
+			 struct fdt_live_node *parent, const char *name,
+			 struct fdt_live_node **childp)
+{
+	int namelen = strlen(name);
+	struct fdt_live_node *node;
+	char *s;
+
+	if (_fdt_live_subnode_namelen(parent, name, namelen))
+		return -FDT_ERR_EXISTS;
+
+	node = _fdt_live_alloc(tree, sizeof(*node));
+	s = _fdt_live_alloc(tree, namelen);
+	if (!node || !s)
+		return -FDT_ERR_NOSPACE;
+	memcpy(s, name, namelen);
+	memset(node, 0, sizeof(*node));
+	node->name = s;
+	node->namelen = namelen;
+	node->parent = parent;
+	node->sibling = parent->child;
+	parent->child = node;
+
+	if (childp)
+		*childp = node;
+	return 0;
+}
+
+int fdt_live_del_node(struct fdt_live_node *node)
+{
+	struct fdt_live_node **pp;
+
+	if (!node->parent)
+		return -FDT_ERR_BADOFFSET;
+
+	for (pp = &node->parent->child; *pp != node; pp = &(*pp)->sibling)
+		;
+	*pp = node->sibling;
+	return 0;
+}
+
+int fdt_live_add_mem_rsv(struct fdt_live_tree *tree, uint64_t address,
+			 uint64_t size)
+{
+	struct fdt_live_rsv **tail = &tree->rsv;
+	struct fdt_live_rsv *rsv;
+
+	rsv = _fdt_live_alloc(tree, sizeof(*rsv));
+	if (!rsv)
+		return -FDT_ERR_NOSPACE;
+	rsv->address = address;
+	rsv->size = size;
+	rsv->next = NULL;
+
+	while (*tail)
+		tail = &(*tail)->next;
+	*tail = rsv;
+	return 0;
+}
+
+/*
+ * Steps to the next node in depth first order. Returns the number of
+ * nodes ended on the way, the new node is NULL after the root node.
+ */
+static int _fdt_live_next(struct fdt_live_node **nodep)
+{
+	struct fdt_live_node *node = *nodep;
+	int ended = 0;
+
+	if (node->child) {
+		*nodep = node->child;
+		return 0;
+	}
+
+	while (node) {
+		ended++;
+		if (node->sibling) {
+			*nodep = node->sibling;
+			return ended;
+		}
+		node = node->parent;
+	}
+	*nodep = NULL;
+	return ended;
+}
+
+/* Also gives each property name in use its offset in the strings block */
+static void _fdt_live_sizes(struct fdt_live_tree *tree, int *struct_size,
+			    int *strings_size)
+{
+	struct fdt_live_node *node = tree->root;
+	struct fdt_live_prop *prop;
+	struct fdt_live_name *name;
+	uint32_t i;
+
+	for (i = 0; i <= tree->names_mask; i++)
+		for (name = tree->names[i]; name; name = name->next)
+			name->nameoff = -1;
+
+	*struct_size = FDT_TAGSIZE;	/* FDT_END */
+	*strings_size = 0;
+	while (node) {
+		*struct_size += FDT_TAGSIZE + FDT_TAGALIGN(node->namelen + 1);
+		for (prop = node->props; prop; prop = prop->next) {
+			*struct_size += sizeof(struct fdt_property) +
+					FDT_TAGALIGN(prop->len);
+			if (prop->name->nameoff < 0) {
+				prop->name->nameoff = *strings_size;
+				*strings_size += prop->name->len + 1;
+			}
+		}
+		*struct_size += _fdt_live_next(&node) * FDT_TAGSIZE;
+	}
+}
+
+static char *_fdt_live_put_tag(char *p, uint32_t tag)
+{
+	*(fdt32_t *)p = cpu_to_fdt32(tag);
+	return p + FDT_TAGSIZE;
+}
+
+/* Writes len bytes of data padded with zeroes to size, aligned to a tag */
+static char *_fdt_live_put_data(char *p, const void *data, int len,
+				int size)
+{
+	int padded = FDT_TAGALIGN(size);
+
+	memcpy(p, data, len);
+	memset(p + len, 0, padded - len);
+	return p + padded;
+}
+
+int fdt_live_flatten(struct fdt_live_tree *tree, void *buf, int bufsize)
+{
+	struct fdt_live_node *node = tree->root;
+	struct fdt_live_prop *prop;
+	struct fdt_reserve_entry *re;
+	struct fdt_live_rsv *rsv;
+	struct fdt_live_name *name;
+	uint32_t i;
+	int struct_size;
+	int strings_size;
+	int off_mem_rsvmap = FDT_ALIGN(sizeof(struct fdt_header),
+				       sizeof(uint64_t));
+	int off_dt_struct;
+	int off_dt_strings;
+	int totalsize;
+	char *strings;
+	char *p;
+	int ended;
+
+	_fdt_live_sizes(tree, &struct_size, &strings_size);
+
+	off_dt_struct = off_mem_rsvmap + sizeof(struct fdt_reserve_entry);
+	for (rsv = tree->rsv; rsv; rsv = rsv->next)
+		off_dt_struct += sizeof(struct fdt_reserve_entry);
+	off_dt_strings = off_dt_struct + struct_size;
+	totalsize = off_dt_strings + strings_size;
+	if (totalsize > bufsize)
+		return -FDT_ERR_NOSPACE;
+
+	memset(buf, 0, off_mem_rsvmap);
+	fdt_set_magic(buf, FDT_MAGIC);
+	fdt_set_totalsize(buf, totalsize);
+	fdt_set_off_dt_struct(buf, off_dt_struct);
+	fdt_set_off_dt_strings(buf, off_dt_strings);
+	fdt_set_off_mem_rsvmap(buf, off_mem_rsvmap);
+	fdt_set_version(buf, FDT_LAST_SUPPORTED_VERSION);
+	fdt_set_last_comp_version(buf, FDT_FIRST_SUPPORTED_VERSION);
+	fdt_set_boot_cpuid_phys(buf, tree->boot_cpuid_phys);
+	fdt_set_size_dt_strings(buf, strings_size);
+	fdt_set_size_dt_struct(buf, struct_size);
+
+	re = (struct fdt_reserve_entry *)((char *)buf + off_mem_rsvmap);
+	for (rsv = tree->rsv; rsv; rsv = rsv->next, re++) {
+		re->address = cpu_to_fdt64(rsv->address);
+		re->size = cpu_to_fdt64(rsv->size);
+	}
+	re->address = 0;
+	re->size = 0;
+
+	p = (char *)buf + off_dt_struct;
+	while (node) {
+		p = _fdt_live_put_tag(p, FDT_BEGIN_NODE);
+		p = _fdt_live_put_data(p, node->name, node->namelen,
+				       node->namelen + 1);
+		for (prop = node->props; prop; prop = prop->next) {
+			struct fdt_property *fprop = (struct fdt_property *)p;
+
+			fprop->tag = cpu_to_fdt32(FDT_PROP);
+			fprop->len = cpu_to_fdt32(prop->len);
+			fprop->nameoff = cpu_to_fdt32(prop->name->nameoff);
+			p = _fdt_live_put_data(p + sizeof(*fprop), prop->val,
+					       prop->len, prop->len);
+		}
+		for (ended = _fdt_live_next(&node); ended; ended--)
+			p = _fdt_live_put_tag(p, FDT_END_NODE);
+	}
+	_fdt_live_put_tag(p, FDT_END);
+
+	strings = (char *)buf + off_dt_strings;
+	for (i = 0; i <= tree->names_mask; i++)
+		for (name = tree->names[i]; name; name = name->next)
+			if (name->nameoff >= 0)
+				memcpy(strings + name->nameoff, name->str,
+				       name->len + 1);
+
+	return 0;
+}
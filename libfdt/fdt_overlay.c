@@ -0,0 +1,635 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+struct _fdt_phandle_ent {
+	uint32_t phandle;
+	struct fdt_live_node *node;
+};
+
+struct _fdt_fragment {
+	struct fdt_live_node *frag;
+	struct fdt_live_node *target;
+};
+
+/*
+ * Phandles of the base tree, sorted, and the target of each fragment of
+ * the overlay, both built once per overlay.
+ */
+struct _fdt_overlay {
+	struct fdt_live_tree *tree;
+	struct fdt_live_node *root;
+	struct _fdt_phandle_ent *phandles;
+	int num_phandles;
+	uint32_t max_phandle;
+	struct _fdt_fragment *fragments;
+	int num_fragments;
+};
+
+static int _fdt_live_name_eq(const struct fdt_live_name *name, const char *s,
+			     int len)
+{
+	return name->len == len && !memcmp(name->str, s, len);
+}
+
+static struct fdt_live_prop *_fdt_live_phandle_prop(
+	const struct fdt_live_node *node)
+{
+	struct fdt_live_prop *prop;
+
+	for (prop = node->props; prop; prop = prop->next)
+		if (prop->len == sizeof(fdt32_t) &&
+		    (_fdt_live_name_eq(prop->name, "phandle", 7) ||
+		     _fdt_live_name_eq(prop->name, "linux,phandle", 13)))
+			return prop;
+	return NULL;
+}
+
+static uint32_t _fdt_live_get_phandle(const struct fdt_live_node *node)
+{
+	struct fdt_live_prop *prop = _fdt_live_phandle_prop(node);
+	fdt32_t v;
+
+	if (!prop)
+		return 0;
+	memcpy(&v, prop->val, sizeof(v));
+	return fdt32_to_cpu(v);
+}
+
+/* Exact match, a fixup or fragment name never omits the unit address */
+static struct fdt_live_node *_fdt_live_child(const struct fdt_live_node *node,
+					     const char *name, int namelen)
+{
+	struct fdt_live_node *child;
+
+	for (child = node->child; child; child = child->sibling)
+		if (child->namelen == namelen &&
+		    !memcmp(child->name, name, namelen))
+			return child;
+	return NULL;
+}
+
+/* Returns the cell at offset in the value, copied into the arena first */
+static void *_fdt_live_prop_cell(struct fdt_live_tree *tree,
+				 struct fdt_live_prop *prop, uint32_t offset)
+{
+	const char *val = prop->val;
+	char *p;
+
+	if (offset > (uint32_t)prop->len ||
+	    prop->len - offset < sizeof(fdt32_t))
+		return NULL;
+
+	if (val < tree->arena || val >= tree->arena + tree->used) {
+		p = _fdt_live_alloc(tree, prop->len);
+		if (!p)
+			return NULL;
+		memcpy(p, val, prop->len);
+		prop->val = p;
+		val = p;
+	}
+	return (char *)val + offset;
+}
+
+static int _fdt_live_cell_add(struct fdt_live_tree *tree,
+			      struct fdt_live_prop *prop, uint32_t offset,
+			      uint32_t delta, int set)
+{
+	void *p = _fdt_live_prop_cell(tree, prop, offset);
+	fdt32_t v;
+
+	if (!p)
+		return tree->used < tree->size ? -FDT_ERR_BADOVERLAY :
+						 -FDT_ERR_NOSPACE;
+	memcpy(&v, p, sizeof(v));
+	v = cpu_to_fdt32(set ? delta : fdt32_to_cpu(v) + delta);
+	memcpy(p, &v, sizeof(v));
+	return 0;
+}
+
+/*
+ * Base tree phandles are mostly in tree order already, which keeps the
+ * insertion sort close to linear.
+ */
+static int _fdt_overlay_index_phandles(struct _fdt_overlay *ov)
+{
+	struct fdt_live_node *node;
+	struct _fdt_phandle_ent *ents;
+	int n = 0;
+	int i;
+
+	for (node = ov->tree->root; node; node = fdt_live_next_node(node))
+		if (_fdt_live_get_phandle(node))
+			n++;
+
+	ents = _fdt_live_alloc(ov->tree, n * sizeof(*ents));
+	if (!ents)
+		return -FDT_ERR_NOSPACE;
+
+	n = 0;
+	for (node = ov->tree->root; node; node = fdt_live_next_node(node)) {
+		uint32_t phandle = _fdt_live_get_phandle(node);
+
+		if (!phandle)
+			continue;
+		if (phandle > ov->max_phandle)
+			ov->max_phandle = phandle;
+		for (i = n; i > 0 && ents[i - 1].phandle > phandle; i--)
+			ents[i] = ents[i - 1];
+		ents[i].phandle = phandle;
+		ents[i].node = node;
+		n++;
+	}
+
+	ov->phandles = ents;
+	ov->num_phandles = n;
+	return 0;
+}
+
+static struct fdt_live_node *_fdt_overlay_lookup_phandle(
+	const struct _fdt_overlay *ov, uint32_t phandle)
+{
+	int lo = 0;
+	int hi = ov->num_phandles;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (ov->phandles[mid].phandle == phandle)
+			return ov->phandles[mid].node;
+		if (ov->phandles[mid].phandle < phandle)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return NULL;
+}
+
+/* Moves the phandles of the overlay above those of the base tree */
+static int _fdt_overlay_renumber(struct _fdt_overlay *ov)
+{
+	uint32_t delta = ov->max_phandle;
+	struct fdt_live_node *node;
+	struct fdt_live_prop *prop;
+	uint32_t phandle;
+	int err;
+
+	for (node = ov->root; node; node = fdt_live_next_node(node)) {
+		for (prop = node->props; prop; prop = prop->next) {
+			if (prop->len != sizeof(fdt32_t) ||
+			    (!_fdt_live_name_eq(prop->name, "phandle", 7) &&
+			     !_fdt_live_name_eq(prop->name, "linux,phandle",
+						13)))
+				continue;
+			phandle = _fdt_live_get_phandle(node);
+			if (!phandle || phandle == (uint32_t)-1)
+				return -FDT_ERR_BADPHANDLE;
+			if (phandle >= (uint32_t)-1 - delta)
+				return -FDT_ERR_NOPHANDLES;
+			err = _fdt_live_cell_add(ov->tree, prop, 0, delta, 0);
+			if (err)
+				return err;
+		}
+	}
+	return 0;
+}
+
+/*
+ * __local_fixups__ mirrors the overlay, each property lists the offsets
+ * of phandles within the property of the same name in the overlay.
+ */
+static int _fdt_overlay_local_fixups(struct _fdt_overlay *ov,
+				     const struct fdt_live_node *fixups,
+				     const struct fdt_live_node *node)
+{
+	const struct fdt_live_prop *fixup;
+	struct fdt_live_prop *prop;
+	const struct fdt_live_node *child;
+	struct fdt_live_node *subnode;
+	fdt32_t offset;
+	int i;
+	int err;
+
+	for (fixup = fixups->props; fixup; fixup = fixup->next) {
+		prop = _fdt_live_get_property(node, fixup->name->str);
+		if (!prop || fixup->len % sizeof(fdt32_t))
+			return -FDT_ERR_BADOVERLAY;
+
+		for (i = 0; i < fixup->len; i += sizeof(offset)) {
+			memcpy(&offset, (const char *)fixup->val + i,
+			       sizeof(offset));
+			err = _fdt_live_cell_add(ov->tree, prop,
+						 fdt32_to_cpu(offset),
+						 ov->max_phandle, 0);
+			if (err)
+				return err;
+		}
+	}
+
+	for (child = fixups->child; child; child = child->sibling) {
+		subnode = _fdt_live_child(node, child->name, child->namelen);
+		if (!subnode)
+			return -FDT_ERR_BADOVERLAY;
+		err = _fdt_overlay_local_fixups(ov, child, subnode);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+/* Parses the offset at the end of a "path:property:offset" fixup */
+static int _fdt_overlay_parse_offset(const char *s, const char *end,
+				     uint32_t *offset)
+{
+	uint32_t v = 0;
+
+	if (s == end)
+		return -FDT_ERR_BADOVERLAY;
+	for (; s < end; s++) {
+		if (*s < '0' || *s > '9' || v > ((uint32_t)-1 - 9) / 10)
+			return -FDT_ERR_BADOVERLAY;
+		v = v * 10 + (*s - '0');
+	}
+	*offset = v;
+	return 0;
+}
+
+static int _fdt_overlay_fixup_one(struct _fdt_overlay *ov, const char *s,
+				  int len, uint32_t phandle)
+{
+	const char *end = s + len;
+	const char *name;
+	const char *sep;
+	struct fdt_live_node *node;
+	struct fdt_live_prop *prop;
+	uint32_t offset;
+	int err;
+
+	name = memchr(s, ':', len);
+	if (!name)
+		return -FDT_ERR_BADOVERLAY;
+	sep = memchr(name + 1, ':', end - name - 1);
+	if (!sep)
+		return -FDT_ERR_BADOVERLAY;
+
+	err = _fdt_overlay_parse_offset(sep + 1, end, &offset);
+	if (err)
+		return err;
+
+	node = _fdt_live_path_namelen(ov->root, s, name - s);
+	if (!node)
+		return -FDT_ERR_BADOVERLAY;
+
+	name++;
+	for (prop = node->props; prop; prop = prop->next)
+		if (_fdt_live_name_eq(prop->name, name, sep - name))
+			break;
+	if (!prop)
+		return -FDT_ERR_BADOVERLAY;
+
+	return _fdt_live_cell_add(ov->tree, prop, offset, phandle, 1);
+}
+
+/*
+ * Each property of __fixups__ is a label of the base tree, with a list of
+ * "path:property:offset" places in the overlay referring to it.
+ */
+static int _fdt_overlay_fixups(struct _fdt_overlay *ov,
+			       const struct fdt_live_node *fixups)
+{
+	const struct fdt_live_node *symbols;
+	const struct fdt_live_prop *fixup;
+	struct fdt_live_node *node;
+	const char *path;
+	const char *s;
+	uint32_t phandle;
+	int len;
+	int l;
+	int err;
+
+	symbols = _fdt_live_child(ov->tree->root, "__symbols__", 11);
+	if (!symbols)
+		return -FDT_ERR_NOTFOUND;
+
+	for (fixup = fixups->props; fixup; fixup = fixup->next) {
+		path = fdt_live_getprop(symbols, fixup->name->str, &len);
+		if (!path)
+			return len;
+		if (!len || path[len - 1])
+			return -FDT_ERR_BADOVERLAY;
+		node = fdt_live_path(ov->tree, path);
+		if (!node)
+			return -FDT_ERR_NOTFOUND;
+		phandle = _fdt_live_get_phandle(node);
+		if (!phandle)
+			return -FDT_ERR_NOTFOUND;
+
+		s = fixup->val;
+		for (len = fixup->len; len > 0; len -= l + 1, s += l + 1) {
+			l = strnlen(s, len);
+			if (l == len)
+				return -FDT_ERR_BADOVERLAY;
+			err = _fdt_overlay_fixup_one(ov, s, l, phandle);
+			if (err)
+				return err;
+		}
+	}
+	return 0;
+}
+
+static int _fdt_overlay_target(const struct _fdt_overlay *ov,
+			       const struct fdt_live_node *frag,
+			       struct fdt_live_node **targetp)
+{
+	const void *val;
+	fdt32_t phandle;
+	int len;
+
+	val = fdt_live_getprop(frag, "target", &len);
+	if (val) {
+		if (len != sizeof(phandle))
+			return -FDT_ERR_BADOVERLAY;
+		memcpy(&phandle, val, sizeof(phandle));
+		*targetp = _fdt_overlay_lookup_phandle(ov,
+						fdt32_to_cpu(phandle));
+		return *targetp ? 0 : -FDT_ERR_BADPHANDLE;
+	}
+
+	val = fdt_live_getprop(frag, "target-path", &len);
+	if (!val || !len || ((const char *)val)[len - 1])
+		return -FDT_ERR_BADOVERLAY;
+	*targetp = fdt_live_path(ov->tree, val);
+	return *targetp ? 0 : -FDT_ERR_BADOVERLAY;
+}
+
+/* Fragments are the subnodes of the root without the __xyz__ ones */
+static int _fdt_overlay_index_fragments(struct _fdt_overlay *ov)
+{
+	struct fdt_live_node *frag;
+	int n = 0;
+	int err;
+
+	for (frag = ov->root->child; frag; frag = frag->sibling)
+		n++;
+
+	ov->fragments = _fdt_live_alloc(ov->tree,
+					n * sizeof(*ov->fragments));
+	if (!ov->fragments)
+		return -FDT_ERR_NOSPACE;
+
+	n = 0;
+	for (frag = ov->root->child; frag; frag = frag->sibling) {
+		if (frag->namelen >= 2 && !memcmp(frag->name, "__", 2))
+			continue;
+		if (!_fdt_live_child(frag, "__overlay__", 11))
+			continue;
+		ov->fragments[n].frag = frag;
+		err = _fdt_overlay_target(ov, frag, &ov->fragments[n].target);
+		if (err)
+			return err;
+		n++;
+	}
+	ov->num_fragments = n;
+	return 0;
+}
+
+/*
+ * Properties and new subnodes of the overlay are moved over to the
+ * target, subnodes the target already has are merged.
+ */
+static int _fdt_overlay_merge(struct fdt_live_node *target,
+			      struct fdt_live_node *node)
+{
+	struct fdt_live_prop *prop = node->props;
+	struct fdt_live_node *child = node->child;
+	struct fdt_live_prop *tprop;
+	struct fdt_live_node *tchild;
+	int err;
+
+	while (prop) {
+		struct fdt_live_prop *next = prop->next;
+
+		/* Names of both trees are interned in the same table */
+		for (tprop = target->props; tprop; tprop = tprop->next)
+			if (tprop->name == prop->name)
+				break;
+		if (tprop) {
+			tprop->val = prop->val;
+			tprop->len = prop->len;
+		} else {
+			prop->next = target->props;
+			target->props = prop;
+		}
+		prop = next;
+	}
+	node->props = NULL;
+
+	while (child) {
+		struct fdt_live_node *next = child->sibling;
+
+		tchild = _fdt_live_child(target, child->name, child->namelen);
+		if (tchild) {
+			err = _fdt_overlay_merge(tchild, child);
+			if (err)
+				return err;
+		} else {
+			child->parent = target;
+			child->sibling = target->child;
+			target->child = child;
+		}
+		child = next;
+	}
+	node->child = NULL;
+	return 0;
+}
+
+/*
+ * Labels of the overlay point at "/fragment@N/__overlay__/...", in the
+ * base tree they point at the same place below the target.
+ */
+static int _fdt_overlay_merge_symbols(struct _fdt_overlay *ov,
+				      const struct fdt_live_node *osymbols)
+{
+	const struct fdt_live_prop *prop;
+	struct fdt_live_node *symbols;
+	const struct fdt_live_node *n;
+	struct fdt_live_node *target;
+	const char *path;
+	const char *frag;
+	const char *rest;
+	char *val;
+	char *p;
+	int pathlen;
+	int restlen;
+	int fraglen;
+	int len;
+	int i;
+	int err;
+
+	symbols = _fdt_live_child(ov->tree->root, "__symbols__", 11);
+	if (!symbols) {
+		err = fdt_live_add_subnode(ov->tree, ov->tree->root,
+					   "__symbols__", &symbols);
+		if (err)
+			return err;
+	}
+
+	for (prop = osymbols->props; prop; prop = prop->next) {
+		path = prop->val;
+		if (!prop->len || path[prop->len - 1] || path[0] != '/')
+			return -FDT_ERR_BADOVERLAY;
+
+		frag = path + 1;
+		rest = strchr(frag, '/');
+		if (!rest || strlen(rest) < 12 ||
+		    memcmp(rest, "/__overlay__", 12) ||
+		    (rest[12] != '/' && rest[12] != '\0'))
+			continue;	/* Not below a fragment */
+		fraglen = rest - frag;
+		rest += 12;
+
+		target = NULL;
+		for (i = 0; i < ov->num_fragments; i++)
+			if (ov->fragments[i].frag->namelen == fraglen &&
+			    !memcmp(ov->fragments[i].frag->name, frag,
+				    fraglen))
+				target = ov->fragments[i].target;
+		if (!target)
+			return -FDT_ERR_BADOVERLAY;
+
+		pathlen = 0;
+		for (n = target; n->parent; n = n->parent)
+			pathlen += n->namelen + 1;
+		restlen = strlen(rest);
+		/* The target is the root and the label is on __overlay__ */
+		if (!pathlen && !restlen) {
+			rest = "/";
+			restlen = 1;
+		}
+		len = pathlen + restlen + 1;
+
+		err = fdt_live_setprop_placeholder(ov->tree, symbols,
+						   prop->name->str, len,
+						   (void **)&val);
+		if (err)
+			return err;
+
+		p = val + pathlen;
+		for (n = target; n->parent; n = n->parent) {
+			p -= n->namelen;
+			memcpy(p, n->name, n->namelen);
+			*--p = '/';
+		}
+		memcpy(val + pathlen, rest, restlen + 1);
+	}
+	return 0;
+}
+
+int fdt_live_overlay_apply(struct fdt_live_tree *tree, const void *fdto)
+{
+	struct _fdt_overlay ov;
+	struct fdt_live_node *node;
+	int err;
+	int i;
+
+	FDT_CHECK_HEADER(fdto);
+
+	memset(&ov, 0, sizeof(ov));
+	ov.tree = tree;
+
+	err = _fdt_live_unflatten_nodes(tree, fdto, &ov.root);
+	if (err)
+		return err;
+
+	err = _fdt_overlay_index_phandles(&ov);
+	if (err)
+		return err;
+
+	err = _fdt_overlay_renumber(&ov);
+	if (err)
+		return err;
+
+	node = _fdt_live_child(ov.root, "__local_fixups__", 16);
+	if (node) {
+		err = _fdt_overlay_local_fixups(&ov, node, ov.root);
+		if (err)
+			return err;
+	}
+
+	node = _fdt_live_child(ov.root, "__fixups__", 10);
+	if (node) {
+		err = _fdt_overlay_fixups(&ov, node);
+		if (err)
+			return err;
+	}
+
+	err = _fdt_overlay_index_fragments(&ov);
+	if (err)
+		return err;
+
+	for (i = 0; i < ov.num_fragments; i++) {
+		node = _fdt_live_child(ov.fragments[i].frag, "__overlay__", 11);
+		err = _fdt_overlay_merge(ov.fragments[i].target, node);
+		if (err)
+			return err;
+	}
+
+	node = _fdt_live_child(ov.root, "__symbols__", 11);
+	if (node)
+		return _fdt_overlay_merge_symbols(&ov, node);
+
+	return 0;
+}
@@ -154,7 +154,49 @@ int fdt_subnode_offset(const void *fdt, int parentoffset,
 	return fdt_subnode_offset_namelen(fdt, parentoffset, name, strlen(name));
 }
 
-int fdt_path_offset(const void *fdt, const char *path)
+static int _fdt_subnode_offset_indexed(const void *fdt, struct fdt_index *idx,
+				       int offset, const char *name,
+				       int namelen)
+{
+	struct fdt_index_entry *e = _fdt_index_find(idx, offset);
+	uint32_t hash = _fdt_index_name_hash(name, namelen);
+	int n;
+
+	if (!e)
+		return -FDT_ERR_BADOFFSET;
+
+	/* Skip from one subnode to the next over their subtrees */
+	for (n = e - idx->entries + 1; n < e->next; n = idx->entries[n].next)
+		if ((idx->entries[n].name_hash == hash) &&
+		    _fdt_nodename_eq(fdt, idx->entries[n].offset, name,
+				     namelen))
+			return idx->entries[n].offset;
+
+	return -FDT_ERR_NOTFOUND;
+}
+
+int fdt_index_subnode_offset_namelen(const void *fdt, struct fdt_index *idx,
+				     int parentoffset, const char *name,
+				     int namelen)
+{
+	FDT_CHECK_HEADER(fdt);
+
+	idx = _fdt_index_get(fdt, idx);
+	if (idx)
+		return _fdt_subnode_offset_indexed(fdt, idx, parentoffset,
+						   name, namelen);
+	return fdt_subnode_offset_namelen(fdt, parentoffset, name, namelen);
+}
+
+int fdt_index_subnode_offset(const void *fdt, struct fdt_index *idx,
+			     int parentoffset, const char *name)
+{
+	return fdt_index_subnode_offset_namelen(fdt, idx, parentoffset, name,
+						strlen(name));
+}
+
+static int _fdt_path_offset(const void *fdt, struct fdt_index *idx,
+			    const char *path)
 {
 	const char *end = path + strlen(path);
 	const char *p = path;
@@ -172,7 +214,7 @@ int fdt_path_offset(const void *fdt, const char *path)
 		p = fdt_get_alias_namelen(fdt, p, q - p);
 		if (!p)
 			return -FDT_ERR_BADPATH;
-		offset = fdt_path_offset(fdt, p);
+		offset = _fdt_path_offset(fdt, idx, p);
 
 		p = q;
 	}
@@ -188,7 +230,8 @@ int fdt_path_offset(const void *fdt, const char *path)
 		if (! q)
 			q = end;
 
-		offset = fdt_subnode_offset_namelen(fdt, offset, p, q-p);
+		offset = fdt_index_subnode_offset_namelen(fdt, idx, offset, p,
+							 q-p);
 		if (offset < 0)
 			return offset;
 
@@ -198,6 +241,17 @@ int fdt_path_offset(const void *fdt, const char *path)
 	return offset;
 }
 
+int fdt_path_offset(const void *fdt, const char *path)
+{
+	return _fdt_path_offset(fdt, NULL, path);
+}
+
+int fdt_index_path_offset(const void *fdt, struct fdt_index *idx,
+			  const char *path)
+{
+	return _fdt_path_offset(fdt, idx, path);
+}
+
 const char *fdt_get_name(const void *fdt, int nodeoffset, int *len)
 {
 	const struct fdt_node_header *nh = _fdt_offset_ptr(fdt, nodeoffset);
@@ -320,6 +374,116 @@ const void *fdt_getprop(const void *fdt, int nodeoffset,
 	return fdt_getprop_namelen(fdt, nodeoffset, name, strlen(name), lenp);
 }
 
+void _fdt_getprops_init(int num, const void **vals, int *lens)
+{
+	int n;
+
+	for (n = 0; n < num; n++) {
+		vals[n] = NULL;
+		lens[n] = -FDT_ERR_NOTFOUND;
+	}
+}
+
+int _fdt_getprops_match(const char *name, const void *val, int len,
+			const char *const *names, int num,
+			const void **vals, int *lens)
+{
+	int found = 0;
+	int n;
+
+	/* The first property of a name wins, as with fdt_getprop() */
+	for (n = 0; n < num; n++) {
+		if (vals[n] || strcmp(names[n], name))
+			continue;
+		vals[n] = val;
+		lens[n] = len;
+		found++;
+	}
+	return found;
+}
+
+int fdt_getprops(const void *fdt, int nodeoffset, const char *const *names,
+		 int num, const void **vals, int *lens)
+{
+	const char *name;
+	const void *val;
+	int found = 0;
+	int offset;
+	int len;
+
+	_fdt_getprops_init(num, vals, lens);
+
+	for (offset = fdt_first_property_offset(fdt, nodeoffset);
+	     (offset >= 0) && (found < num);
+	     (offset = fdt_next_property_offset(fdt, offset))) {
+		if (!(val = fdt_getprop_by_offset(fdt, offset, &name, &len)))
+			return len;
+		found += _fdt_getprops_match(name, val, len, names, num,
+					     vals, lens);
+	}
+
+	if ((offset < 0) && (offset != -FDT_ERR_NOTFOUND))
+		return offset;
+	return found;
+}
+
+int fdt_getprops_all(const void *fdt, const char *const *names, int num,
+		     const void **vals, int *lens, fdt_getprops_fn fn,
+		     void *arg)
+{
+	const struct fdt_property *prop;
+	int offset, nextoffset;
+	int nodeoffset = -1;
+	int depth = -1;
+	int found = 0;
+	uint32_t tag;
+	int err;
+
+	FDT_CHECK_HEADER(fdt);
+
+	for (offset = 0; ; offset = nextoffset) {
+		tag = fdt_next_tag(fdt, offset, &nextoffset);
+
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+		case FDT_END_NODE:
+			/* The properties of a node come before its subnodes */
+			if (found) {
+				err = fn(arg, fdt, nodeoffset, depth, vals,
+					 lens);
+				if (err)
+					return err;
+			}
+			found = 0;
+			nodeoffset = -1;
+			if (tag == FDT_END_NODE) {
+				depth--;
+				break;
+			}
+			depth++;
+			nodeoffset = offset;
+			_fdt_getprops_init(num, vals, lens);
+			break;
+
+		case FDT_PROP:
+			if ((nodeoffset < 0) || (found == num))
+				break;
+			/* fdt_next_tag() has checked the bounds */
+			prop = _fdt_offset_ptr(fdt, offset);
+			found += _fdt_getprops_match(
+				fdt_string(fdt, fdt32_to_cpu(prop->nameoff)),
+				prop->data, fdt32_to_cpu(prop->len),
+				names, num, vals, lens);
+			break;
+
+		case FDT_END:
+			if (nextoffset < 0)
+				return nextoffset;
+			return 0;
+		}
+	}
+}
+
 uint32_t fdt_get_phandle(const void *fdt, int nodeoffset)
 {
 	const fdt32_t *php;
@@ -337,6 +501,47 @@ uint32_t fdt_get_phandle(const void *fdt, int nodeoffset)
 	return fdt32_to_cpu(*php);
 }
 
+static int _fdt_max_phandle_fn(void *arg, const void *fdt, int nodeoffset,
+			       int depth, const void *const *vals,
+			       const int *lens)
+{
+	uint32_t *max = arg;
+	uint32_t phandle;
+	int n;
+
+	(void)fdt;
+	(void)nodeoffset;
+	(void)depth;
+
+	/* "phandle" wins over "linux,phandle", as in fdt_get_phandle() */
+	for (n = 0; n < 2; n++) {
+		if (vals[n] && lens[n] == sizeof(fdt32_t)) {
+			phandle = fdt32_to_cpu(*(const fdt32_t *)vals[n]);
+			if (phandle != (uint32_t)-1 && phandle > *max)
+				*max = phandle;
+			break;
+		}
+	}
+	return 0;
+}
+
+int fdt_find_max_phandle(const void *fdt, uint32_t *phandle)
+{
+	static const char * const names[] = { "phandle", "linux,phandle" };
+	const void *vals[2];
+	int lens[2];
+	uint32_t max = 0;
+	int err;
+
+	err = fdt_getprops_all(fdt, names, 2, vals, lens,
+			       _fdt_max_phandle_fn, &max);
+	if (err)
+		return err;
+
+	*phandle = max;
+	return 0;
+}
+
 const char *fdt_get_alias_namelen(const void *fdt,
 				  const char *name, int namelen)
 {
@@ -515,6 +720,116 @@ int fdt_node_offset_by_phandle(const void *fdt, uint32_t phandle)
 	return offset; /* error from fdt_next_node() */
 }
 
+static int _fdt_get_path_indexed(const void *fdt, struct fdt_index *idx,
+				 int nodeoffset, char *buf, int buflen)
+{
+	struct fdt_index_entry *e = _fdt_index_find(idx, nodeoffset);
+	int p = 0;
+	int namelen;
+	const char *name;
+
+	if (!e)
+		return -FDT_ERR_BADOFFSET;
+	if (e->parent < 0) {
+		buf[0] = '/';
+		buf[1] = '\0';
+		return 0;
+	}
+
+	/* Length of the path first, then filled in from the end */
+	for (; e->parent >= 0; e = idx->entries + e->parent) {
+		name = fdt_get_name(fdt, e->offset, &namelen);
+		if (!name)
+			return namelen;
+		p += namelen + 1;
+	}
+	if (p + 1 > buflen)
+		return -FDT_ERR_NOSPACE;
+
+	buf[p] = '\0';
+	for (e = _fdt_index_find(idx, nodeoffset); e->parent >= 0;
+	     e = idx->entries + e->parent) {
+		name = fdt_get_name(fdt, e->offset, &namelen);
+		p -= namelen;
+		memcpy(buf + p, name, namelen);
+		buf[--p] = '/';
+	}
+	return 0;
+}
+
+int fdt_index_get_path(const void *fdt, struct fdt_index *idx, int nodeoffset,
+		       char *buf, int buflen)
+{
+	FDT_CHECK_HEADER(fdt);
+
+	if (buflen < 2)
+		return -FDT_ERR_NOSPACE;
+
+	idx = _fdt_index_get(fdt, idx);
+	if (idx)
+		return _fdt_get_path_indexed(fdt, idx, nodeoffset, buf, buflen);
+	return fdt_get_path(fdt, nodeoffset, buf, buflen);
+}
+
+int fdt_index_node_depth(const void *fdt, struct fdt_index *idx,
+			 int nodeoffset)
+{
+	struct fdt_index_entry *e;
+
+	FDT_CHECK_HEADER(fdt);
+
+	idx = _fdt_index_get(fdt, idx);
+	if (!idx)
+		return fdt_node_depth(fdt, nodeoffset);
+
+	e = _fdt_index_find(idx, nodeoffset);
+	if (!e)
+		return -FDT_ERR_BADOFFSET;
+	return e->depth;
+}
+
+int fdt_index_parent_offset(const void *fdt, struct fdt_index *idx,
+			    int nodeoffset)
+{
+	struct fdt_index_entry *e;
+
+	FDT_CHECK_HEADER(fdt);
+
+	idx = _fdt_index_get(fdt, idx);
+	if (!idx)
+		return fdt_parent_offset(fdt, nodeoffset);
+
+	e = _fdt_index_find(idx, nodeoffset);
+	if (!e)
+		return -FDT_ERR_BADOFFSET;
+	if (e->parent < 0)
+		return -FDT_ERR_NOTFOUND;
+	return idx->entries[e->parent].offset;
+}
+
+int fdt_index_node_offset_by_phandle(const void *fdt, struct fdt_index *idx,
+				     uint32_t phandle)
+{
+	int offset;
+	int n;
+
+	if ((phandle == 0) || (phandle == -1))
+		return -FDT_ERR_BADPHANDLE;
+
+	FDT_CHECK_HEADER(fdt);
+
+	/* Phandles may have been set since indexed, so check them */
+	idx = _fdt_index_get(fdt, idx);
+	for (n = 0; idx && n < idx->count; n++) {
+		offset = idx->entries[n].offset;
+		if ((idx->entries[n].phandle == phandle) &&
+		    (fdt_get_phandle(fdt, offset) == phandle))
+			return offset;
+	}
+
+	return fdt_node_offset_by_phandle(fdt, phandle);
+}
+
 int fdt_stringlist_contains(const char *strlist, int listlen, const char *str)
 {
 	int len = strlen(str);
@@ -120,7 +120,7 @@ static int _fdt_splice_mem_rsv(void *fdt, struct fdt_reserve_entry *p,
 	return 0;
 }
 
-static int _fdt_splice_struct(void *fdt, void *p,
+static int _fdt_splice_struct(void *fdt, struct fdt_index *idx, void *p,
 			      int oldlen, int newlen)
 {
 	int delta = newlen - oldlen;
@@ -131,37 +131,156 @@ static int _fdt_splice_struct(void *fdt, void *p,
 
 	fdt_set_size_dt_struct(fdt, fdt_size_dt_struct(fdt) + delta);
 	fdt_set_off_dt_strings(fdt, fdt_off_dt_strings(fdt) + delta);
+	_fdt_index_splice(idx, (char *)p - (char *)_fdt_offset_ptr(fdt, 0),
+			  oldlen, newlen);
 	return 0;
 }
 
-static int _fdt_splice_string(void *fdt, int newlen)
+#define FDT_STRINGS_INDEX_MIN_SLOTS	16
+
+static const char *_fdt_strings_index_find(struct fdt_strings_index *idx,
+					   const char *strtab, int tabsize,
+					   const char *s, int len,
+					   uint32_t hash)
+{
+	uint32_t n;
+	uint32_t off;
+
+	for (n = hash & idx->mask; idx->slots[n]; n = (n + 1) & idx->mask) {
+		off = idx->slots[n] - 1;
+		if (off + len <= (uint32_t)tabsize &&
+		    memcmp(strtab + off, s, len) == 0)
+			return strtab + off;
+	}
+	return NULL;
+}
+
+static void _fdt_strings_index_insert(struct fdt_strings_index *idx,
+				      int off, uint32_t hash)
+{
+	uint32_t n;
+
+	/* Keep the load below 3/4, after that the index isn't used */
+	if ((uint32_t)(idx->count + 1) > idx->mask - idx->mask / 4) {
+		idx->count = -1;
+		return;
+	}
+
+	for (n = hash & idx->mask; idx->slots[n]; n = (n + 1) & idx->mask)
+		;
+	idx->slots[n] = off + 1;
+	idx->count++;
+}
+
+static void _fdt_strings_index_reset(struct fdt_strings_index *idx)
+{
+	memset(idx->slots, 0, (idx->mask + 1) * sizeof(idx->slots[0]));
+	idx->indexed = 0;
+	idx->count = 0;
+}
+
+/*
+ * Returns idx with the strings added to fdt without it indexed too, or
+ * NULL if there's no index or it's full.
+ */
+static struct fdt_strings_index *_fdt_strings_index_get(void *fdt,
+					struct fdt_strings_index *idx)
+{
+	const char *strtab = (const char *)fdt + fdt_off_dt_strings(fdt);
+	int tabsize = fdt_size_dt_strings(fdt);
+	const char *p;
+	uint32_t hash;
+	int len;
+
+	if (!idx)
+		return NULL;
+	if (tabsize < idx->indexed)
+		_fdt_strings_index_reset(idx);
+
+	while (idx->count >= 0 && idx->indexed < tabsize) {
+		p = strtab + idx->indexed;
+		len = strnlen(p, tabsize - idx->indexed);
+		if (len == tabsize - idx->indexed)
+			break;	/* Not terminated, leave it to the scan */
+		len++;
+
+		hash = fdt_fnv1a(p, len);
+		if (!_fdt_strings_index_find(idx, strtab, tabsize, p, len,
+					     hash))
+			_fdt_strings_index_insert(idx, idx->indexed, hash);
+		idx->indexed += len;
+	}
+
+	if (idx->count < 0)
+		return NULL;
+	return idx;
+}
+
+int fdt_strings_index_init(struct fdt_strings_index *idx, void *buf,
+			   int bufsize)
+{
+	uint32_t nslots = FDT_STRINGS_INDEX_MIN_SLOTS;
+
+	if (bufsize < 0 ||
+	    (uint32_t)bufsize < nslots * sizeof(idx->slots[0]))
+		return -FDT_ERR_NOSPACE;
+	while (nslots * 2 <= bufsize / sizeof(idx->slots[0]))
+		nslots *= 2;
+
+	idx->mask = nslots - 1;
+	idx->slots = buf;
+	_fdt_strings_index_reset(idx);
+	return 0;
+}
+
+/*
+ * Adds newlen bytes at the end of the strings block for a string with
+ * the hash given, indexed in idx if idx is up to date. The caller
+ * copies the string in.
+ */
+static int _fdt_splice_string(void *fdt, struct fdt_strings_index *idx,
+			      int newlen, uint32_t hash)
 {
-	void *p = (char *)fdt
-		+ fdt_off_dt_strings(fdt) + fdt_size_dt_strings(fdt);
+	int oldsize = fdt_size_dt_strings(fdt);
+	void *p = (char *)fdt + fdt_off_dt_strings(fdt) + oldsize;
 	int err;
 
 	if ((err = _fdt_splice(fdt, p, 0, newlen)))
 		return err;
 
-	fdt_set_size_dt_strings(fdt, fdt_size_dt_strings(fdt) + newlen);
+	fdt_set_size_dt_strings(fdt, oldsize + newlen);
+	if (idx && idx->indexed == oldsize) {
+		_fdt_strings_index_insert(idx, oldsize, hash);
+		idx->indexed += newlen;
+	}
 	return 0;
 }
 
-static int _fdt_find_add_string(void *fdt, const char *s)
+static int _fdt_find_add_string(void *fdt, struct fdt_strings_index *idx,
+				const char *s)
 {
 	char *strtab = (char *)fdt + fdt_off_dt_strings(fdt);
 	const char *p;
 	char *new;
 	int len = strlen(s) + 1;
+	uint32_t hash = 0;
 	int err;
 
-	p = _fdt_find_string(strtab, fdt_size_dt_strings(fdt), s);
+	idx = _fdt_strings_index_get(fdt, idx);
+	if (idx) {
+		hash = fdt_fnv1a(s, len);
+		p = _fdt_strings_index_find(idx, strtab,
+					    fdt_size_dt_strings(fdt), s, len,
+					    hash);
+	} else {
+		p = _fdt_find_string(strtab, fdt_size_dt_strings(fdt), s);
+	}
 	if (p)
 		/* found it */
 		return (p - strtab);
 
 	new = strtab + fdt_size_dt_strings(fdt);
-	err = _fdt_splice_string(fdt, len);
+	err = _fdt_splice_string(fdt, idx, len, hash);
 	if (err)
 		return err;
 
@@ -202,8 +321,9 @@ int fdt_del_mem_rsv(void *fdt, int n)
 	return 0;
 }
 
-static int _fdt_resize_property(void *fdt, int nodeoffset, const char *name,
-				int len, struct fdt_property **prop)
+static int _fdt_resize_property(void *fdt, struct fdt_index *idx,
+				int nodeoffset, const char *name, int len,
+				struct fdt_property **prop)
 {
 	int oldlen;
 	int err;
@@ -212,16 +332,18 @@ static int _fdt_resize_property(void *fdt, int nodeoffset, const char *name,
 	if (! (*prop))
 		return oldlen;
 
-	if ((err = _fdt_splice_struct(fdt, (*prop)->data, FDT_TAGALIGN(oldlen),
-				      FDT_TAGALIGN(len))))
+	if ((err = _fdt_splice_struct(fdt, idx, (*prop)->data,
+				      FDT_TAGALIGN(oldlen), FDT_TAGALIGN(len))))
 		return err;
 
 	(*prop)->len = cpu_to_fdt32(len);
 	return 0;
 }
 
-static int _fdt_add_property(void *fdt, int nodeoffset, const char *name,
-			     int len, struct fdt_property **prop)
+static int _fdt_add_property(void *fdt, struct fdt_strings_index *sidx,
+			     struct fdt_index *idx, int nodeoffset,
+			     const char *name, int len,
+			     struct fdt_property **prop)
 {
 	int proplen;
 	int nextoffset;
@@ -231,14 +353,14 @@ static int _fdt_add_property(void *fdt, int nodeoffset, const char *name,
 	if ((nextoffset = _fdt_check_node_offset(fdt, nodeoffset)) < 0)
 		return nextoffset;
 
-	namestroff = _fdt_find_add_string(fdt, name);
+	namestroff = _fdt_find_add_string(fdt, sidx, name);
 	if (namestroff < 0)
 		return namestroff;
 
 	*prop = _fdt_offset_ptr_w(fdt, nextoffset);
 	proplen = sizeof(**prop) + FDT_TAGALIGN(len);
 
-	err = _fdt_splice_struct(fdt, *prop, 0, proplen);
+	err = _fdt_splice_struct(fdt, idx, *prop, 0, proplen);
 	if (err)
 		return err;
 
@@ -248,7 +370,8 @@ static int _fdt_add_property(void *fdt, int nodeoffset, const char *name,
 	return 0;
 }
 
-int fdt_set_name(void *fdt, int nodeoffset, const char *name)
+static int _fdt_set_name(void *fdt, struct fdt_index *idx, int nodeoffset,
+			 const char *name)
 {
 	char *namep;
 	int oldlen, newlen;
@@ -262,26 +385,40 @@ int fdt_set_name(void *fdt, int nodeoffset, const char *name)
 
 	newlen = strlen(name);
 
-	err = _fdt_splice_struct(fdt, namep, FDT_TAGALIGN(oldlen+1),
+	err = _fdt_splice_struct(fdt, idx, namep, FDT_TAGALIGN(oldlen+1),
 				 FDT_TAGALIGN(newlen+1));
 	if (err)
 		return err;
 
 	memcpy(namep, name, newlen+1);
+	_fdt_index_rename(idx, nodeoffset, name, newlen);
 	return 0;
 }
 
-int fdt_setprop(void *fdt, int nodeoffset, const char *name,
-		const void *val, int len)
+int fdt_set_name(void *fdt, int nodeoffset, const char *name)
+{
+	return _fdt_set_name(fdt, NULL, nodeoffset, name);
+}
+
+int fdt_index_set_name(void *fdt, struct fdt_index *idx, int nodeoffset,
+		       const char *name)
+{
+	return _fdt_set_name(fdt, idx, nodeoffset, name);
+}
+
+static int _fdt_setprop(void *fdt, struct fdt_strings_index *sidx,
+			struct fdt_index *idx, int nodeoffset, const char *name,
+			const void *val, int len)
 {
 	struct fdt_property *prop;
 	int err;
 
 	FDT_RW_CHECK_HEADER(fdt);
 
-	err = _fdt_resize_property(fdt, nodeoffset, name, len, &prop);
+	err = _fdt_resize_property(fdt, idx, nodeoffset, name, len, &prop);
 	if (err == -FDT_ERR_NOTFOUND)
-		err = _fdt_add_property(fdt, nodeoffset, name, len, &prop);
+		err = _fdt_add_property(fdt, sidx, idx, nodeoffset, name, len,
+					&prop);
 	if (err)
 		return err;
 
@@ -289,8 +426,29 @@ int fdt_setprop(void *fdt, int nodeoffset, const char *name,
 	return 0;
 }
 
-int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
-		   const void *val, int len)
+int fdt_setprop(void *fdt, int nodeoffset, const char *name,
+		const void *val, int len)
+{
+	return _fdt_setprop(fdt, NULL, NULL, nodeoffset, name, val, len);
+}
+
+int fdt_setprop_indexed(void *fdt, struct fdt_strings_index *idx,
+			int nodeoffset, const char *name,
+			const void *val, int len)
+{
+	return _fdt_setprop(fdt, idx, NULL, nodeoffset, name, val, len);
+}
+
+int fdt_index_setprop(void *fdt, struct fdt_index *idx, int nodeoffset,
+		      const char *name, const void *val, int len)
+{
+	return _fdt_setprop(fdt, idx->strings, idx, nodeoffset, name, val,
+			    len);
+}
+
+static int _fdt_appendprop(void *fdt, struct fdt_strings_index *idx,
+			   int nodeoffset, const char *name,
+			   const void *val, int len)
 {
 	struct fdt_property *prop;
 	int err, oldlen, newlen;
@@ -300,7 +458,7 @@ int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
 	prop = fdt_get_property_w(fdt, nodeoffset, name, &oldlen);
 	if (prop) {
 		newlen = len + oldlen;
-		err = _fdt_splice_struct(fdt, prop->data,
+		err = _fdt_splice_struct(fdt, NULL, prop->data,
 					 FDT_TAGALIGN(oldlen),
 					 FDT_TAGALIGN(newlen));
 		if (err)
@@ -308,7 +466,8 @@ int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
 		prop->len = cpu_to_fdt32(newlen);
 		memcpy(prop->data + oldlen, val, len);
 	} else {
-		err = _fdt_add_property(fdt, nodeoffset, name, len, &prop);
+		err = _fdt_add_property(fdt, idx, NULL, nodeoffset, name, len,
+					&prop);
 		if (err)
 			return err;
 		memcpy(prop->data, val, len);
@@ -316,7 +475,21 @@ int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
 	return 0;
 }
 
-int fdt_delprop(void *fdt, int nodeoffset, const char *name)
+int fdt_appendprop(void *fdt, int nodeoffset, const char *name,
+		   const void *val, int len)
+{
+	return _fdt_appendprop(fdt, NULL, nodeoffset, name, val, len);
+}
+
+int fdt_appendprop_indexed(void *fdt, struct fdt_strings_index *idx,
+			   int nodeoffset, const char *name,
+			   const void *val, int len)
+{
+	return _fdt_appendprop(fdt, idx, nodeoffset, name, val, len);
+}
+
+static int _fdt_delprop(void *fdt, struct fdt_index *idx, int nodeoffset,
+			const char *name)
 {
 	struct fdt_property *prop;
 	int len, proplen;
@@ -328,11 +501,23 @@ int fdt_delprop(void *fdt, int nodeoffset, const char *name)
 		return len;
 
 	proplen = sizeof(*prop) + FDT_TAGALIGN(len);
-	return _fdt_splice_struct(fdt, prop, proplen, 0);
+	return _fdt_splice_struct(fdt, idx, prop, proplen, 0);
 }
 
-int fdt_add_subnode_namelen(void *fdt, int parentoffset,
-			    const char *name, int namelen)
+int fdt_delprop(void *fdt, int nodeoffset, const char *name)
+{
+	return _fdt_delprop(fdt, NULL, nodeoffset, name);
+}
+
+int fdt_index_delprop(void *fdt, struct fdt_index *idx, int nodeoffset,
+		      const char *name)
+{
+	return _fdt_delprop(fdt, idx, nodeoffset, name);
+}
+
+static int _fdt_add_subnode_namelen(void *fdt, struct fdt_index *idx,
+				    int parentoffset, const char *name,
+				    int namelen)
 {
 	struct fdt_node_header *nh;
 	int offset, nextoffset;
@@ -343,7 +528,8 @@ int fdt_add_subnode_namelen(void *fdt, int parentoffset,
 
 	FDT_RW_CHECK_HEADER(fdt);
 
-	offset = fdt_subnode_offset_namelen(fdt, parentoffset, name, namelen);
+	offset = fdt_index_subnode_offset_namelen(fdt, idx, parentoffset, name,
+						 namelen);
 	if (offset >= 0)
 		return -FDT_ERR_EXISTS;
 	else if (offset != -FDT_ERR_NOTFOUND)
@@ -359,7 +545,7 @@ int fdt_add_subnode_namelen(void *fdt, int parentoffset,
 	nh = _fdt_offset_ptr_w(fdt, offset);
 	nodelen = sizeof(*nh) + FDT_TAGALIGN(namelen+1) + FDT_TAGSIZE;
 
-	err = _fdt_splice_struct(fdt, nh, 0, nodelen);
+	err = _fdt_splice_struct(fdt, idx, nh, 0, nodelen);
 	if (err)
 		return err;
 
@@ -368,18 +554,42 @@ int fdt_add_subnode_namelen(void *fdt, int parentoffset,
 	memcpy(nh->name, name, namelen);
 	endtag = (fdt32_t *)((char *)nh + nodelen - FDT_TAGSIZE);
 	*endtag = cpu_to_fdt32(FDT_END_NODE);
+	_fdt_index_add(idx, parentoffset, offset, name, namelen);
 
 	return offset;
 }
 
+int fdt_add_subnode_namelen(void *fdt, int parentoffset,
+			    const char *name, int namelen)
+{
+	return _fdt_add_subnode_namelen(fdt, NULL, parentoffset, name,
+					namelen);
+}
+
 int fdt_add_subnode(void *fdt, int parentoffset, const char *name)
 {
 	return fdt_add_subnode_namelen(fdt, parentoffset, name, strlen(name));
 }
 
-int fdt_del_node(void *fdt, int nodeoffset)
+int fdt_index_add_subnode_namelen(void *fdt, struct fdt_index *idx,
+				  int parentoffset, const char *name,
+				  int namelen)
+{
+	return _fdt_add_subnode_namelen(fdt, idx, parentoffset, name,
+					namelen);
+}
+
+int fdt_index_add_subnode(void *fdt, struct fdt_index *idx, int parentoffset,
+			  const char *name)
+{
+	return _fdt_add_subnode_namelen(fdt, idx, parentoffset, name,
+					strlen(name));
+}
+
+static int _fdt_del_node(void *fdt, struct fdt_index *idx, int nodeoffset)
 {
 	int endoffset;
+	int err;
 
 	FDT_RW_CHECK_HEADER(fdt);
 
@@ -387,8 +597,23 @@ int fdt_del_node(void *fdt, int nodeoffset)
 	if (endoffset < 0)
 		return endoffset;
 
-	return _fdt_splice_struct(fdt, _fdt_offset_ptr_w(fdt, nodeoffset),
-				  endoffset - nodeoffset, 0);
+	/* Before the splice shifts the nodes following the subtree */
+	_fdt_index_remove(idx, nodeoffset);
+	err = _fdt_splice_struct(fdt, idx, _fdt_offset_ptr_w(fdt, nodeoffset),
+				 endoffset - nodeoffset, 0);
+	if (err && idx)
+		fdt_index_invalidate(idx);
+	return err;
+}
+
+int fdt_del_node(void *fdt, int nodeoffset)
+{
+	return _fdt_del_node(fdt, NULL, nodeoffset);
+}
+
+int fdt_index_del_node(void *fdt, struct fdt_index *idx, int nodeoffset)
+{
+	return _fdt_del_node(fdt, idx, nodeoffset);
 }
 
 static void _fdt_packblocks(const char *old, char *new,
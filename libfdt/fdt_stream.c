@@ -0,0 +1,225 @@
+/*
+ * libfdt - Flat Device Tree manipulation
+ * Copyright (C) 2014 Linaro Limited
+ *
+ * libfdt is dual licensed: you can use it either under the terms of
+ * the GPL, or the BSD license, at your option.
+ *
+ *  a) This library is free software; you can redistribute it and/or
+ *     modify it under the terms of the GNU General Public License as
+ *     published by the Free Software Foundation; either version 2 of the
+ *     License, or (at your option) any later version.
+ *
+ *     This library is distributed in the hope that it will be useful,
+ *     but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *     GNU General Public License for more details.
+ *
+ *     You should have received a copy of the GNU General Public
+ *     License along with this library; if not, write to the Free
+ *     Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ *     MA 02110-1301 USA
+ *
+ * Alternatively,
+ *
+ *  b) Redistribution and use in source and binary forms, with or
+ *     without modification, are permitted provided that the following
+ *     conditions are met:
+ *
+ *     1. Redistributions of source code must retain the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer.
+ *     2. Redistributions in binary form must reproduce the above
+ *        copyright notice, this list of conditions and the following
+ *        disclaimer in the documentation and/or other materials
+ *        provided with the distribution.
+ *
+ *     THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *     CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *     INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *     MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *     DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ *     CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *     SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ *     NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *     LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ *     HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *     CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ *     OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ *     EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "libfdt_env.h"
+
+#include <fdt.h>
+#include <libfdt.h>
+
+#include "libfdt_internal.h"
+
+struct fdt_stream_state {
+	const struct fdt_stream_ops *ops;
+	void *arg;
+	void *out;
+	const void *fdt;
+	int stack[FDT_STREAM_MAX_DEPTH];
+	int depth;
+	int skip_depth;
+	int in_props;
+};
+
+static int _fdt_stream_end_props(struct fdt_stream_state *s)
+{
+	s->in_props = 0;
+	if (!s->ops->end_props)
+		return 0;
+	return s->ops->end_props(s->arg, s->out, s->fdt, s->stack[s->depth]);
+}
+
+static int _fdt_stream_begin_node(struct fdt_stream_state *s, int offset)
+{
+	int parent;
+	int err;
+
+	if (s->in_props) {
+		err = _fdt_stream_end_props(s);
+		if (err)
+			return err;
+	}
+
+	if (++s->depth >= FDT_STREAM_MAX_DEPTH)
+		return -FDT_ERR_BADSTRUCTURE;
+	s->stack[s->depth] = offset;
+
+	/* The subnodes of a node left out go with it */
+	if (s->skip_depth >= 0)
+		return 0;
+
+	if (s->ops->node) {
+		parent = s->depth ? s->stack[s->depth - 1] : -1;
+		err = s->ops->node(s->arg, s->out, s->fdt, offset, parent);
+		if (err < 0)
+			return err;
+		if (err == FDT_STREAM_SKIP) {
+			s->skip_depth = s->depth;
+			return 0;
+		}
+	}
+
+	s->in_props = 1;
+	return fdt_begin_node(s->out, fdt_get_name_unchecked(s->fdt, offset));
+}
+
+static int _fdt_stream_property(struct fdt_stream_state *s, int offset)
+{
+	const char *name;
+	const void *val;
+	int len;
+	int err;
+
+	if (s->skip_depth >= 0)
+		return 0;
+
+	val = fdt_getprop_by_offset_unchecked(s->fdt, offset, &name, &len);
+
+	if (s->ops->property) {
+		err = s->ops->property(s->arg, s->out, s->fdt,
+				       s->stack[s->depth], name, val, len);
+		if (err < 0)
+			return err;
+		if (err == FDT_STREAM_SKIP)
+			return 0;
+	}
+
+	return fdt_property(s->out, name, val, len);
+}
+
+static int _fdt_stream_end_node(struct fdt_stream_state *s)
+{
+	int err;
+
+	if (s->skip_depth >= 0) {
+		if (s->skip_depth == s->depth)
+			s->skip_depth = -1;
+		s->depth--;
+		return 0;
+	}
+
+	if (s->in_props) {
+		err = _fdt_stream_end_props(s);
+		if (err)
+			return err;
+	}
+	s->depth--;
+	return fdt_end_node(s->out);
+}
+
+int fdt_stream(const void *fdt, void *buf, int bufsize,
+	       const struct fdt_stream_ops *ops, void *arg)
+{
+	static const struct fdt_stream_ops copy_ops;
+	struct fdt_stream_state s;
+	int offset, nextoffset;
+	uint64_t addr, size;
+	uint32_t tag;
+	int err;
+	int n;
+
+	s.ops = ops ? ops : &copy_ops;
+	s.arg = arg;
+	s.out = buf;
+	s.fdt = fdt;
+	s.depth = -1;
+	s.skip_depth = -1;
+	s.in_props = 0;
+
+	err = fdt_create(buf, bufsize);
+	if (err)
+		return err;
+
+	for (n = 0; n < fdt_num_mem_rsv(fdt); n++) {
+		err = fdt_get_mem_rsv(fdt, n, &addr, &size);
+		if (err)
+			return err;
+		err = fdt_add_reservemap_entry(buf, addr, size);
+		if (err)
+			return err;
+	}
+	if (s.ops->mem_rsv) {
+		err = s.ops->mem_rsv(arg, buf, fdt);
+		if (err)
+			return err;
+	}
+	err = fdt_finish_reservemap(buf);
+	if (err)
+		return err;
+
+	for (offset = 0; ; offset = nextoffset) {
+		tag = fdt_next_tag_unchecked(fdt, offset, &nextoffset);
+		switch (tag) {
+		case FDT_BEGIN_NODE:
+			err = _fdt_stream_begin_node(&s, offset);
+			break;
+
+		case FDT_PROP:
+			err = _fdt_stream_property(&s, offset);
+			break;
+
+		case FDT_END_NODE:
+			err = _fdt_stream_end_node(&s);
+			break;
+
+		case FDT_NOP:
+			err = 0;
+			break;
+
+		default:
+			/* FDT_END, fdt_check_full() has checked the rest */
+			err = fdt_finish(buf);
+			if (err)
+				return err;
+			fdt_set_boot_cpuid_phys(buf, fdt_boot_cpuid_phys(fdt));
+			return 0;
+		}
+		if (err)
+			return err;
+	}
+}
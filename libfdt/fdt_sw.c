@@ -82,7 +82,8 @@ static void *_fdt_grab_space(void *fdt, size_t len)
 		return NULL;
 
 	fdt_set_size_dt_struct(fdt, offset + len);
-	return _fdt_offset_ptr_w(fdt, offset);
+	/* Only what's used is cleared, for the padding of names and values */
+	return memset(_fdt_offset_ptr_w(fdt, offset), 0, len);
 }
 
 int fdt_create(void *buf, int bufsize)
@@ -92,7 +93,7 @@ int fdt_create(void *buf, int bufsize)
 	if (bufsize < sizeof(struct fdt_header))
 		return -FDT_ERR_NOSPACE;
 
-	memset(buf, 0, bufsize);
+	memset(buf, 0, sizeof(struct fdt_header));
 
 	fdt_set_magic(fdt, FDT_SW_MAGIC);
 	fdt_set_version(fdt, FDT_LAST_SUPPORTED_VERSION);
@@ -188,7 +189,8 @@ static int _fdt_find_add_string(void *fdt, const char *s)
 	return offset;
 }
 
-int fdt_property(void *fdt, const char *name, const void *val, int len)
+int fdt_property_placeholder(void *fdt, const char *name, int len,
+			     void **valp)
 {
 	struct fdt_property *prop;
 	int nameoff;
@@ -206,7 +208,19 @@ int fdt_property(void *fdt, const char *name, const void *val, int len)
 	prop->tag = cpu_to_fdt32(FDT_PROP);
 	prop->nameoff = cpu_to_fdt32(nameoff);
 	prop->len = cpu_to_fdt32(len);
-	memcpy(prop->data, val, len);
+	*valp = prop->data;
+	return 0;
+}
+
+int fdt_property(void *fdt, const char *name, const void *val, int len)
+{
+	void *ptr;
+	int ret;
+
+	ret = fdt_property_placeholder(fdt, name, len, &ptr);
+	if (ret)
+		return ret;
+	memcpy(ptr, val, len);
 	return 0;
 }
 
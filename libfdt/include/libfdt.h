@@ -116,7 +116,25 @@
 	 * Should never be returned, if it is, it indicates a bug in
 	 * libfdt itself. */
 
-#define FDT_ERR_MAX		13
+/* Errors in device tree overlays */
+#define FDT_ERR_BADOVERLAY	14
+	/* FDT_ERR_BADOVERLAY: The device tree overlay, while
+	 * correctly structured, has a fragment, fixup or symbol that
+	 * can't be applied to the base tree. */
+#define FDT_ERR_NOPHANDLES	15
+	/* FDT_ERR_NOPHANDLES: The device tree doesn't have any
+	 * phandle available anymore without causing an overflow */
+
+/* Errors in addresses and sizes */
+#define FDT_ERR_BADNCELLS	16
+	/* FDT_ERR_BADNCELLS: Device tree has a #address-cells or
+	 * #size-cells property with an invalid or unsupported value */
+#define FDT_ERR_BADVALUE	17
+	/* FDT_ERR_BADVALUE: A reg or ranges property has a length
+	 * that isn't a whole number of entries, or a value doesn't fit
+	 * in the cells it's to be encoded in */
+
+#define FDT_ERR_MAX		17
 
 /**********************************************************************/
 /* Low-level functions (you probably don't need these)                */
@@ -569,6 +587,76 @@ static inline void *fdt_getprop_w(void *fdt, int nodeoffset,
 	return (void *)(uintptr_t)fdt_getprop(fdt, nodeoffset, name, lenp);
 }
 
+/**
+ * fdt_getprops - retrieve the values of several properties of a node
+ * @fdt: pointer to the device tree blob
+ * @nodeoffset: offset of the node whose properties to find
+ * @names: names of the properties to find
+ * @num: number of names
+ * @vals: array of num pointers, filled in with the values
+ * @lens: array of num integers, filled in with the lengths
+ *
+ * fdt_getprops() looks all the properties up in a single pass over the
+ * properties of the node, instead of one pass for each fdt_getprop().
+ * For each name the value and length are stored at the same index of
+ * vals and lens, as fdt_getprop() returns them. A property the node
+ * lacks gets a NULL value and a length of -FDT_ERR_NOTFOUND.
+ *
+ * returns:
+ *	the number of properties found (>=0), on success
+ *	-FDT_ERR_BADOFFSET, nodeoffset did not point to FDT_BEGIN_NODE tag
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_getprops(const void *fdt, int nodeoffset, const char *const *names,
+		 int num, const void **vals, int *lens);
+
+/**
+ * fdt_getprops_fn - called by fdt_getprops_all() for a node
+ * @arg: as passed to fdt_getprops_all()
+ * @fdt: pointer to the device tree blob
+ * @nodeoffset: offset of the node
+ * @depth: depth of the node, 0 for the root node
+ * @vals: values of the properties of the node, as from fdt_getprops()
+ * @lens: lengths of the properties
+ *
+ * Returns 0 to go on with the next node, anything else stops the walk
+ * and is returned by fdt_getprops_all().
+ */
+typedef int (*fdt_getprops_fn)(void *arg, const void *fdt, int nodeoffset,
+			       int depth, const void *const *vals,
+			       const int *lens);
+
+/**
+ * fdt_getprops_all - retrieve several properties of every node
+ * @fdt: pointer to the device tree blob
+ * @names: names of the properties to find
+ * @num: number of names
+ * @vals: array of num pointers, for the values
+ * @lens: array of num integers, for the lengths
+ * @fn: called for each node with at least one of the properties
+ * @arg: passed to fn
+ *
+ * fdt_getprops_all() walks the structure block once and does what
+ * fdt_getprops() does for each node on the way, in the order of the
+ * blob. fn must not change the blob.
+ *
+ * returns:
+ *	0, once all nodes are done
+ *	non-zero value returned by fn, if it stopped the walk
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_getprops_all(const void *fdt, const char *const *names, int num,
+		     const void **vals, int *lens, fdt_getprops_fn fn,
+		     void *arg);
+
 /**
  * fdt_get_phandle - retrieve the phandle of a given node
  * @fdt: pointer to the device tree blob
@@ -583,6 +671,24 @@ static inline void *fdt_getprop_w(void *fdt, int nodeoffset,
  */
 uint32_t fdt_get_phandle(const void *fdt, int nodeoffset);
 
+/**
+ * fdt_find_max_phandle - find the highest phandle in a tree
+ * @fdt: pointer to the device tree blob
+ * @phandle: returns the highest phandle, 0 if no node has one
+ *
+ * fdt_find_max_phandle() walks the structure block once, a new node can
+ * use the phandle found plus one.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_find_max_phandle(const void *fdt, uint32_t *phandle);
+
 /**
  * fdt_get_alias_namelen - get alias based on substring
  * @fdt: pointer to the device tree blob
@@ -1018,6 +1124,406 @@ int fdt_nop_property(void *fdt, int nodeoffset, const char *name);
  */
 int fdt_nop_node(void *fdt, int nodeoffset);
 
+/**********************************************************************/
+/* Validation and unchecked access                                    */
+/**********************************************************************/
+
+/**
+ * fdt_check_full - check that a device tree blob is well-formed
+ * @fdt: pointer to the device tree blob
+ * @bufsize: size of the memory fdt is in
+ *
+ * fdt_check_full() checks the whole blob once: the header and the
+ * bounds of the blocks, the memory reservation list, and every tag of
+ * the structure block. Node names and property names must be
+ * terminated, values must be within the structure block, nodes must be
+ * balanced under a single root node, and properties must come before
+ * the subnodes of a node.
+ *
+ * A blob that passes can be read with the fdt_*_unchecked() functions
+ * below. They skip the checks of the offsets and bounds done by each
+ * of the other read-only functions. Offsets passed to them must come
+ * from them or from the other read-only functions, and the blob must
+ * not be changed in between.
+ *
+ * returns:
+ *	0, if the blob is well-formed
+ *	-FDT_ERR_TRUNCATED, something runs past a block or past bufsize
+ *	-FDT_ERR_BADLAYOUT, a block is misaligned or overlaps the header
+ *	-FDT_ERR_BADSTRUCTURE, bad tag, property name or nesting of nodes
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE, standard meanings
+ */
+int fdt_check_full(const void *fdt, size_t bufsize);
+
+/**
+ * fdt_next_tag_unchecked - fdt_next_tag() of a checked blob
+ */
+uint32_t fdt_next_tag_unchecked(const void *fdt, int offset, int *nextoffset);
+
+/**
+ * fdt_next_node_unchecked - fdt_next_node() of a checked blob
+ *
+ * Unlike fdt_next_node(), -FDT_ERR_NOTFOUND is also returned when *depth
+ * drops below 0.
+ */
+int fdt_next_node_unchecked(const void *fdt, int offset, int *depth);
+
+/**
+ * fdt_first_property_offset_unchecked - fdt_first_property_offset() of a
+ *	checked blob
+ */
+int fdt_first_property_offset_unchecked(const void *fdt, int nodeoffset);
+
+/**
+ * fdt_next_property_offset_unchecked - fdt_next_property_offset() of a
+ *	checked blob
+ */
+int fdt_next_property_offset_unchecked(const void *fdt, int offset);
+
+/**
+ * fdt_getprop_by_offset_unchecked - fdt_getprop_by_offset() of a checked
+ *	blob
+ */
+const void *fdt_getprop_by_offset_unchecked(const void *fdt, int offset,
+					    const char **namep, int *lenp);
+
+/**
+ * fdt_getprop_unchecked - fdt_getprop() of a checked blob
+ */
+const void *fdt_getprop_unchecked(const void *fdt, int nodeoffset,
+				  const char *name, int *lenp);
+
+/**
+ * fdt_getprops_unchecked - fdt_getprops() of a checked blob
+ */
+int fdt_getprops_unchecked(const void *fdt, int nodeoffset,
+			   const char *const *names, int num,
+			   const void **vals, int *lens);
+
+/**
+ * fdt_get_name_unchecked - fdt_get_name() of a checked blob
+ */
+const char *fdt_get_name_unchecked(const void *fdt, int nodeoffset);
+
+/**
+ * fdt_subnode_offset_unchecked - fdt_subnode_offset() of a checked blob
+ */
+int fdt_subnode_offset_unchecked(const void *fdt, int parentoffset,
+				 const char *name);
+
+/**********************************************************************/
+/* Address cells, reg and ranges                                      */
+/**********************************************************************/
+
+/* Cells of an address or a size decoded into 64 bits, at most */
+#define FDT_MAX_NCELLS		2
+
+/* Cells of an address, the one above the 64 bits is decoded apart (PCI) */
+#define FDT_MAX_ADDR_NCELLS	3
+
+/**
+ * fdt_address_cells - retrieve the #address-cells of a node
+ * @fdt: pointer to the device tree blob
+ * @nodeoffset: offset of the node, the parent of the nodes with reg
+ *
+ * returns:
+ *	1 to 3, the number of cells, 2 if the node has no #address-cells
+ *	-FDT_ERR_BADNCELLS, the value is bad or wider than FDT_MAX_ADDR_NCELLS
+ *	-FDT_ERR_BADOFFSET,
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_address_cells(const void *fdt, int nodeoffset);
+
+/**
+ * fdt_size_cells - retrieve the #size-cells of a node
+ * @fdt: pointer to the device tree blob
+ * @nodeoffset: offset of the node, the parent of the nodes with reg
+ *
+ * returns:
+ *	0 to 2, the number of cells, 1 if the node has no #size-cells
+ *	otherwise as fdt_address_cells()
+ */
+int fdt_size_cells(const void *fdt, int nodeoffset);
+
+/**
+ * fdt_address_cells_val - decode the value of an #address-cells property
+ * @val: value of the property, NULL if it wasn't found
+ * @len: length of the value, or the error the lookup returned
+ *
+ * For values already fetched, with fdt_getprops() for instance.
+ *
+ * returns:
+ *	as fdt_address_cells(), len if the lookup failed for another reason
+ *	than -FDT_ERR_NOTFOUND
+ */
+int fdt_address_cells_val(const void *val, int len);
+
+/**
+ * fdt_size_cells_val - decode the value of a #size-cells property
+ * @val: value of the property, NULL if it wasn't found
+ * @len: length of the value, or the error the lookup returned
+ *
+ * returns:
+ *	as fdt_size_cells(), len if the lookup failed for another reason
+ *	than -FDT_ERR_NOTFOUND
+ */
+int fdt_size_cells_val(const void *val, int len);
+
+/**
+ * struct fdt_cells - cell sizes of a node, for the reg of its subnodes
+ * @nodeoffset: offset of the node the sizes are of, -1 for none
+ * @addr_cells: #address-cells of the node
+ * @size_cells: #size-cells of the node
+ */
+struct fdt_cells {
+	int nodeoffset;
+	int addr_cells;
+	int size_cells;
+};
+
+#define FDT_CELLS_INIT	{ -1, 0, 0 }
+
+/**
+ * fdt_cells_get - retrieve the cell sizes of a node, cached
+ * @fdt: pointer to the device tree blob
+ * @nodeoffset: offset of the node
+ * @cells: cell sizes, initialized with FDT_CELLS_INIT
+ *
+ * fdt_cells_get() only looks the properties up if @cells holds the
+ * sizes of another node, so sibling nodes walked in a row share one
+ * lookup in their parent.
+ *
+ * returns:
+ *	0, on success
+ *	otherwise as fdt_address_cells()
+ */
+int fdt_cells_get(const void *fdt, int nodeoffset, struct fdt_cells *cells);
+
+/*
+ * Decodes ncells cells, 0 to FDT_MAX_NCELLS. The callers check ncells
+ * beforehand, as the iterators do when they are set up: wider values
+ * don't fit in the result.
+ */
+static inline uint64_t fdt_read_cells(const fdt32_t *cell, int ncells)
+{
+	switch (ncells) {
+	case 0:
+		return 0;
+	case 1:
+		return fdt32_to_cpu(cell[0]);
+	case 2:
+		return ((uint64_t)fdt32_to_cpu(cell[0]) << 32) |
+		       fdt32_to_cpu(cell[1]);
+	default:
+		return 0;
+	}
+}
+
+/**
+ * struct fdt_reg - entry of a reg property
+ * @address: address of the region
+ * @size: size of the region
+ */
+struct fdt_reg {
+	uint64_t address;
+	uint64_t size;
+};
+
+/**
+ * struct fdt_reg_iter - iterator over the entries of a reg property
+ * @num: number of entries
+ *
+ * The remaining fields are private to libfdt.
+ */
+struct fdt_reg_iter {
+	int num;
+	const fdt32_t *cell;
+	const fdt32_t *end;
+	int addr_cells;
+	int size_cells;
+};
+
+/**
+ * fdt_reg_iter_init - start decoding a reg property
+ * @iter: iterator to set up
+ * @val: value of the property, 4 byte aligned as in a blob
+ * @len: length of the value
+ * @addr_cells: #address-cells of the parent of the node
+ * @size_cells: #size-cells of the parent of the node
+ *
+ * addr_cells is at most FDT_MAX_NCELLS, so the reg of PCI devices, with
+ * 3 address cells, is rejected instead of truncated.
+ *
+ * returns:
+ *	0, on success, iter->num is the number of entries
+ *	-FDT_ERR_BADNCELLS, addr_cells or size_cells isn't supported
+ *	-FDT_ERR_BADVALUE, len isn't a whole number of entries
+ */
+int fdt_reg_iter_init(struct fdt_reg_iter *iter, const void *val, int len,
+		      int addr_cells, int size_cells);
+
+/**
+ * fdt_reg_iter_next - decode the next entry of a reg property
+ * @iter: iterator set up with fdt_reg_iter_init()
+ * @reg: filled in with the entry
+ *
+ * returns:
+ *	1, if reg was filled in
+ *	0, once all entries are decoded
+ */
+static inline int fdt_reg_iter_next(struct fdt_reg_iter *iter,
+				    struct fdt_reg *reg)
+{
+	const fdt32_t *c = iter->cell;
+
+	if (c >= iter->end)
+		return 0;
+
+	/* The common layouts, with the cell counts known */
+	if (iter->addr_cells == 2 && iter->size_cells == 2) {
+		reg->address = fdt_read_cells(c, 2);
+		reg->size = fdt_read_cells(c + 2, 2);
+		iter->cell = c + 4;
+	} else if (iter->addr_cells == 1 && iter->size_cells == 1) {
+		reg->address = fdt32_to_cpu(c[0]);
+		reg->size = fdt32_to_cpu(c[1]);
+		iter->cell = c + 2;
+	} else {
+		reg->address = fdt_read_cells(c, iter->addr_cells);
+		reg->size = fdt_read_cells(c + iter->addr_cells,
+					   iter->size_cells);
+		iter->cell = c + iter->addr_cells + iter->size_cells;
+	}
+	return 1;
+}
+
+/**
+ * fdt_reg_encode - encode entries of a reg property
+ * @buf: 4 byte aligned memory for the value
+ * @bufsize: size of buf
+ * @addr_cells: #address-cells of the parent of the node
+ * @size_cells: #size-cells of the parent of the node
+ * @regs: entries to encode
+ * @num: number of entries
+ *
+ * Use fdt_reg_size() for the size of the value beforehand, to add a
+ * placeholder property of that size and encode into it.
+ *
+ * returns:
+ *	the length of the value (>=0), on success
+ *	-FDT_ERR_NOSPACE, buf is too small
+ *	-FDT_ERR_BADVALUE, an address or size doesn't fit in its cells
+ *	-FDT_ERR_BADNCELLS, addr_cells or size_cells isn't supported
+ */
+int fdt_reg_encode(void *buf, int bufsize, int addr_cells, int size_cells,
+		   const struct fdt_reg *regs, int num);
+
+/* Length of a reg property of num entries */
+static inline int fdt_reg_size(int addr_cells, int size_cells, int num)
+{
+	return (addr_cells + size_cells) * (int)sizeof(fdt32_t) * num;
+}
+
+/**
+ * struct fdt_range - entry of a ranges property
+ * @child_hi: cell above the 64 bits of child, 0 with less than 3 cells
+ * @parent_hi: cell above the 64 bits of parent, 0 with less than 3 cells
+ * @child: address in the address space of the node
+ * @parent: address in the address space of the parent
+ * @size: size of the range
+ *
+ * With the 3 address cells of PCI, child_hi is the phys.hi cell holding
+ * the space code and child the 64 bit address in that space.
+ */
+struct fdt_range {
+	uint32_t child_hi;
+	uint32_t parent_hi;
+	uint64_t child;
+	uint64_t parent;
+	uint64_t size;
+};
+
+/**
+ * struct fdt_ranges_iter - iterator over the entries of a ranges property
+ * @num: number of entries
+ *
+ * The remaining fields are private to libfdt.
+ */
+struct fdt_ranges_iter {
+	int num;
+	const fdt32_t *cell;
+	const fdt32_t *end;
+	int child_cells;
+	int parent_cells;
+	int size_cells;
+};
+
+/**
+ * fdt_ranges_iter_init - start decoding a ranges property
+ * @iter: iterator to set up
+ * @val: value of the property, 4 byte aligned as in a blob
+ * @len: length of the value, 0 for an identity mapping with no entries
+ * @child_cells: #address-cells of the node
+ * @parent_cells: #address-cells of the parent of the node
+ * @size_cells: #size-cells of the node
+ *
+ * returns:
+ *	0, on success, iter->num is the number of entries
+ *	-FDT_ERR_BADNCELLS, child_cells or parent_cells isn't 1 to
+ *		FDT_MAX_ADDR_NCELLS, or size_cells isn't 0 to FDT_MAX_NCELLS
+ *	-FDT_ERR_BADVALUE, len isn't a whole number of entries
+ */
+int fdt_ranges_iter_init(struct fdt_ranges_iter *iter, const void *val,
+			 int len, int child_cells, int parent_cells,
+			 int size_cells);
+
+/* Decodes an address of 1 to FDT_MAX_ADDR_NCELLS cells, the third in *hi */
+static inline uint64_t fdt_read_addr_cells(const fdt32_t *cell, int ncells,
+					   uint32_t *hi)
+{
+	*hi = 0;
+	if (ncells > FDT_MAX_NCELLS) {
+		*hi = fdt32_to_cpu(cell[0]);
+		cell += ncells - FDT_MAX_NCELLS;
+		ncells = FDT_MAX_NCELLS;
+	}
+	return fdt_read_cells(cell, ncells);
+}
+
+/**
+ * fdt_ranges_iter_next - decode the next entry of a ranges property
+ * @iter: iterator set up with fdt_ranges_iter_init()
+ * @range: filled in with the entry
+ *
+ * returns:
+ *	1, if range was filled in
+ *	0, once all entries are decoded
+ */
+static inline int fdt_ranges_iter_next(struct fdt_ranges_iter *iter,
+				       struct fdt_range *range)
+{
+	const fdt32_t *c = iter->cell;
+
+	if (c >= iter->end)
+		return 0;
+
+	range->child = fdt_read_addr_cells(c, iter->child_cells,
+					   &range->child_hi);
+	c += iter->child_cells;
+	range->parent = fdt_read_addr_cells(c, iter->parent_cells,
+					    &range->parent_hi);
+	c += iter->parent_cells;
+	range->size = fdt_read_cells(c, iter->size_cells);
+	iter->cell = c + iter->size_cells;
+	return 1;
+}
+
 /**********************************************************************/
 /* Sequential write functions                                         */
 /**********************************************************************/
@@ -1027,6 +1533,25 @@ int fdt_add_reservemap_entry(void *fdt, uint64_t addr, uint64_t size);
 int fdt_finish_reservemap(void *fdt);
 int fdt_begin_node(void *fdt, const char *name);
 int fdt_property(void *fdt, const char *name, const void *val, int len);
+
+/**
+ * fdt_property_placeholder - add a property without a value yet
+ * @fdt: pointer to the device tree blob being written
+ * @name: name of the property
+ * @len: length of the value
+ * @valp: returns a pointer to where the value is to be written
+ *
+ * fdt_property_placeholder() adds a property of len bytes and leaves
+ * the value to the caller, through *valp. Values don't move until
+ * fdt_finish().
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, there's no room left in the blob
+ *	-FDT_ERR_BADMAGIC, fdt isn't being written
+ */
+int fdt_property_placeholder(void *fdt, const char *name, int len,
+			     void **valp);
 static inline int fdt_property_u32(void *fdt, const char *name, uint32_t val)
 {
 	fdt32_t tmp = cpu_to_fdt32(val);
@@ -1046,6 +1571,67 @@ static inline int fdt_property_cell(void *fdt, const char *name, uint32_t val)
 int fdt_end_node(void *fdt);
 int fdt_finish(void *fdt);
 
+/* Returned by the fdt_stream_ops callbacks to leave something out */
+#define FDT_STREAM_SKIP		1
+
+/**
+ * struct fdt_stream_ops - filters of fdt_stream()
+ * @node: called before a node is written, with the offset of its parent,
+ *	-1 for the root node. Returns 0 to copy the node, FDT_STREAM_SKIP
+ *	to leave the node and its subnodes out, or an error.
+ * @property: called for each property of a copied node. Returns 0 to
+ *	copy the property, FDT_STREAM_SKIP to leave it out or when the
+ *	callback has written a replacement itself, or an error.
+ * @end_props: called once the properties of a copied node are written,
+ *	before its subnodes, to add properties or whole subnodes. Returns
+ *	0 or an error.
+ * @mem_rsv: called once the memory reserve map entries of fdt are
+ *	copied, to add more with fdt_add_reservemap_entry(). Returns 0 or
+ *	an error.
+ *
+ * Each callback gets the blob being written as out, any of them may be
+ * NULL.
+ */
+struct fdt_stream_ops {
+	int (*node)(void *arg, void *out, const void *fdt, int nodeoffset,
+		    int parentoffset);
+	int (*property)(void *arg, void *out, const void *fdt,
+			int nodeoffset, const char *name, const void *val,
+			int len);
+	int (*end_props)(void *arg, void *out, const void *fdt,
+			 int nodeoffset);
+	int (*mem_rsv)(void *arg, void *out, const void *fdt);
+};
+
+/* Nesting of nodes fdt_stream() keeps track of */
+#define FDT_STREAM_MAX_DEPTH	32
+
+/**
+ * fdt_stream - write a filtered copy of a device tree in one pass
+ * @fdt: pointer to the device tree blob to copy
+ * @buf: memory for the new blob
+ * @bufsize: size of buf
+ * @ops: filters, or NULL for a plain copy
+ * @arg: passed to the filters
+ *
+ * fdt_stream() walks the structure block of fdt once and writes each
+ * node and property out with the sequential write functions, as @ops
+ * lets it, together with the memory reservations. The new blob is
+ * packed, fdt_totalsize() of it is the exact size written. buf must not
+ * overlap fdt.
+ *
+ * fdt must have passed fdt_check_full(), it's walked with the unchecked
+ * functions.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, buf is too small for the new blob
+ *	-FDT_ERR_BADSTRUCTURE, nodes nested deeper than FDT_STREAM_MAX_DEPTH
+ *	or an error returned by one of the filters
+ */
+int fdt_stream(const void *fdt, void *buf, int bufsize,
+	       const struct fdt_stream_ops *ops, void *arg);
+
 /**********************************************************************/
 /* Read-write functions                                               */
 /**********************************************************************/
@@ -1505,6 +2091,611 @@ int fdt_add_subnode(void *fdt, int parentoffset, const char *name);
  */
 int fdt_del_node(void *fdt, int nodeoffset);
 
+/**********************************************************************/
+/* Strings block index                                                */
+/**********************************************************************/
+
+/**
+ * struct fdt_strings_index - hash index over the strings block
+ * @indexed: number of bytes at the start of the strings block indexed
+ * @count: number of strings in the index, -1 once it's full
+ * @mask: number of slots minus one
+ * @slots: string offset plus one for each used slot, 0 for free slots
+ *
+ * The fields are private to libfdt.
+ */
+struct fdt_strings_index {
+	int indexed;
+	int count;
+	uint32_t mask;
+	uint32_t *slots;
+};
+
+/**
+ * fdt_strings_index_init - set up an index of property names
+ * @idx: index state
+ * @buf: memory for the hash slots, must stay valid as long as idx is used
+ * @bufsize: size of buf, 4 bytes per slot
+ *
+ * fdt_strings_index_init() prepares idx for fdt_setprop_indexed() and
+ * fdt_appendprop_indexed(), which look property names up in the
+ * strings block through a hash index instead of searching the whole
+ * block for each name. The index is built on first use and kept up to
+ * date as names are added, names added by other functions are indexed
+ * on the next indexed call.
+ *
+ * An index belongs to one blob, it stays valid when the blob is moved
+ * with fdt_open_into() or packed. Index hits are always checked
+ * against the strings block, used with another blob it can at worst
+ * make a name added twice. Names only present as the tail of another
+ * string aren't found either, they're added to the strings block again.
+ * Once the slots fill up names are searched for without the index.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, buf has room for less than 16 slots
+ */
+int fdt_strings_index_init(struct fdt_strings_index *idx, void *buf,
+			   int bufsize);
+
+/**
+ * fdt_setprop_indexed - fdt_setprop() with a strings block index
+ * @fdt: pointer to the device tree blob
+ * @idx: index set up with fdt_strings_index_init()
+ * @nodeoffset: offset of the node whose property to change
+ * @name: name of the property to change
+ * @val: pointer to data to set the property value to
+ * @len: length of the property value
+ *
+ * Like fdt_setprop(), but a name not in the node yet is looked up in the
+ * strings block through idx.
+ *
+ * returns:
+ *	the same values as fdt_setprop()
+ */
+int fdt_setprop_indexed(void *fdt, struct fdt_strings_index *idx,
+			int nodeoffset, const char *name,
+			const void *val, int len);
+
+/**
+ * fdt_appendprop_indexed - fdt_appendprop() with a strings block index
+ * @fdt: pointer to the device tree blob
+ * @idx: index set up with fdt_strings_index_init()
+ * @nodeoffset: offset of the node whose property to change
+ * @name: name of the property to append to
+ * @val: pointer to data to append to the property value
+ * @len: length of the data to append to the property value
+ *
+ * Like fdt_appendprop(), but a name not in the node yet is looked up in
+ * the strings block through idx.
+ *
+ * returns:
+ *	the same values as fdt_appendprop()
+ */
+int fdt_appendprop_indexed(void *fdt, struct fdt_strings_index *idx,
+			   int nodeoffset, const char *name,
+			   const void *val, int len);
+
+/**********************************************************************/
+/* Node index                                                         */
+/**********************************************************************/
+
+/**
+ * struct fdt_index_entry - one node in a node index
+ * @offset: structure block offset of the node
+ * @parent: entry of the parent node, -1 for the root node
+ * @next: entry following the subtree of the node
+ * @depth: depth of the node, 0 for the root node
+ * @name_hash: hash of the node name without the unit address
+ * @phandle: phandle of the node as indexed, 0 if none
+ */
+struct fdt_index_entry {
+	int offset;
+	int parent;
+	int next;
+	int depth;
+	uint32_t name_hash;
+	uint32_t phandle;
+};
+
+/**
+ * struct fdt_index - index over the nodes of a tree
+ *
+ * The fields are private to libfdt.
+ */
+struct fdt_index {
+	struct fdt_index_entry *entries;
+	struct fdt_strings_index *strings;
+	int max;
+	int count;
+	int struct_size;
+	int state;
+};
+
+/**
+ * fdt_index_init - set up an index of the nodes of a tree
+ * @idx: index state
+ * @buf: 4 byte aligned memory for the entries, must stay valid as long
+ *	as idx is used
+ * @bufsize: size of buf, sizeof(struct fdt_index_entry) per node
+ * @strings: strings block index fdt_index_setprop() uses, or NULL
+ *
+ * fdt_index_init() prepares idx for the fdt_index_*() functions below,
+ * which use an array of all nodes with their parent, depth, name hash
+ * and phandle instead of walking the structure block from the root
+ * each time. The array is built in one pass over the tags on first use.
+ *
+ * The fdt_index_*() read-write functions patch the index as they change
+ * the blob. After any other change that moves nodes, call
+ * fdt_index_invalidate(). A change of the structure block size is
+ * noticed without it. Phandles found in the index are checked, a miss
+ * falls back to a walk. An index belongs to one blob, it stays valid
+ * when the blob is moved with fdt_open_into() or packed.
+ *
+ * If buf is too small for all nodes the lookups walk the structure
+ * block as the functions without an index do.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, buf is too small for a single entry
+ */
+int fdt_index_init(struct fdt_index *idx, void *buf, int bufsize,
+		   struct fdt_strings_index *strings);
+
+/**
+ * fdt_index_invalidate - rebuild the node index on next use
+ * @idx: index set up with fdt_index_init()
+ */
+void fdt_index_invalidate(struct fdt_index *idx);
+
+/**
+ * fdt_index_subnode_offset_namelen - fdt_subnode_offset_namelen() with
+ *	a node index
+ * @fdt: pointer to the device tree blob
+ * @idx: index set up with fdt_index_init()
+ * @parentoffset: structure block offset of a node
+ * @name: name of the subnode to locate
+ * @namelen: number of characters of name to consider
+ *
+ * Skips from one subnode to the next over their subtrees, comparing
+ * names only when their hashes match.
+ *
+ * returns:
+ *	the same values as fdt_subnode_offset_namelen()
+ */
+int fdt_index_subnode_offset_namelen(const void *fdt, struct fdt_index *idx,
+				     int parentoffset, const char *name,
+				     int namelen);
+
+/**
+ * fdt_index_subnode_offset - fdt_subnode_offset() with a node index
+ */
+int fdt_index_subnode_offset(const void *fdt, struct fdt_index *idx,
+			     int parentoffset, const char *name);
+
+/**
+ * fdt_index_path_offset - fdt_path_offset() with a node index
+ *
+ * Costs a subnode lookup in the index per path component.
+ */
+int fdt_index_path_offset(const void *fdt, struct fdt_index *idx,
+			  const char *path);
+
+/**
+ * fdt_index_get_path - fdt_get_path() with a node index
+ *
+ * Follows the parents of the node instead of walking the tree up to it.
+ */
+int fdt_index_get_path(const void *fdt, struct fdt_index *idx, int nodeoffset,
+		       char *buf, int buflen);
+
+/**
+ * fdt_index_node_depth - fdt_node_depth() with a node index
+ */
+int fdt_index_node_depth(const void *fdt, struct fdt_index *idx,
+			 int nodeoffset);
+
+/**
+ * fdt_index_parent_offset - fdt_parent_offset() with a node index
+ */
+int fdt_index_parent_offset(const void *fdt, struct fdt_index *idx,
+			    int nodeoffset);
+
+/**
+ * fdt_index_node_offset_by_phandle - fdt_node_offset_by_phandle() with a
+ *	node index
+ *
+ * Searches the phandles in the index before walking the tree.
+ */
+int fdt_index_node_offset_by_phandle(const void *fdt, struct fdt_index *idx,
+				     uint32_t phandle);
+
+/**
+ * fdt_index_setprop - fdt_setprop() keeping a node index up to date
+ *
+ * Names are looked up through the strings block index given to
+ * fdt_index_init(), if any.
+ */
+int fdt_index_setprop(void *fdt, struct fdt_index *idx, int nodeoffset,
+		      const char *name, const void *val, int len);
+
+/**
+ * fdt_index_delprop - fdt_delprop() keeping a node index up to date
+ */
+int fdt_index_delprop(void *fdt, struct fdt_index *idx, int nodeoffset,
+		      const char *name);
+
+/**
+ * fdt_index_set_name - fdt_set_name() keeping a node index up to date
+ */
+int fdt_index_set_name(void *fdt, struct fdt_index *idx, int nodeoffset,
+		       const char *name);
+
+/**
+ * fdt_index_add_subnode_namelen - fdt_add_subnode_namelen() keeping a node
+ *	index up to date
+ */
+int fdt_index_add_subnode_namelen(void *fdt, struct fdt_index *idx,
+				  int parentoffset, const char *name,
+				  int namelen);
+
+/**
+ * fdt_index_add_subnode - fdt_add_subnode() keeping a node index up to date
+ */
+int fdt_index_add_subnode(void *fdt, struct fdt_index *idx, int parentoffset,
+			  const char *name);
+
+/**
+ * fdt_index_del_node - fdt_del_node() keeping a node index up to date
+ */
+int fdt_index_del_node(void *fdt, struct fdt_index *idx, int nodeoffset);
+
+/**********************************************************************/
+/* Live tree                                                          */
+/**********************************************************************/
+
+/**
+ * struct fdt_live_name - property name shared by all properties using it
+ *
+ * The fields are private to libfdt.
+ */
+struct fdt_live_name {
+	struct fdt_live_name *next;
+	const char *str;
+	int len;
+	int nameoff;
+};
+
+/**
+ * struct fdt_live_prop - property of a node in a live tree
+ * @next: next property of the node
+ * @name: name of the property
+ * @val: value of the property, in the source blob or the arena
+ * @len: length of the value
+ */
+struct fdt_live_prop {
+	struct fdt_live_prop *next;
+	struct fdt_live_name *name;
+	const void *val;
+	int len;
+};
+
+/**
+ * struct fdt_live_node - node in a live tree
+ * @parent: parent node, NULL for the root node
+ * @child: first subnode
+ * @sibling: next subnode of the parent
+ * @props: first property
+ * @name: name of the node, including any unit address, not terminated
+ * @namelen: length of the name
+ */
+struct fdt_live_node {
+	struct fdt_live_node *parent;
+	struct fdt_live_node *child;
+	struct fdt_live_node *sibling;
+	struct fdt_live_prop *props;
+	const char *name;
+	int namelen;
+};
+
+/**
+ * struct fdt_live_rsv - memory reservation of a live tree
+ * @next: next reservation
+ * @address: start of the reserved range
+ * @size: size of the reserved range
+ */
+struct fdt_live_rsv {
+	struct fdt_live_rsv *next;
+	uint64_t address;
+	uint64_t size;
+};
+
+/**
+ * struct fdt_live_tree - device tree unflattened into an arena
+ * @root: root node
+ * @rsv: memory reservations, in order
+ * @boot_cpuid_phys: physical CPU id of the boot CPU
+ *
+ * The remaining fields are private to libfdt.
+ */
+struct fdt_live_tree {
+	struct fdt_live_node *root;
+	struct fdt_live_rsv *rsv;
+	uint32_t boot_cpuid_phys;
+	char *arena;
+	int size;
+	int used;
+	struct fdt_live_name **names;
+	uint32_t names_mask;
+};
+
+/**
+ * fdt_live_unflatten - turn a device tree blob into a live tree
+ * @fdt: pointer to the device tree blob
+ * @tree: live tree to fill in
+ * @buf: 8 byte aligned memory for the nodes, properties and new values
+ * @bufsize: size of buf
+ *
+ * fdt_live_unflatten() walks the structure block once and builds a
+ * tree of nodes and properties in buf. Names and values point into the
+ * blob, so it must stay unchanged until the tree has been flattened.
+ * Edits to the tree are pointer operations, with any new names and
+ * values copied into buf, and fdt_live_flatten() writes it back as a
+ * packed blob in one go.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, buf is too small for the tree
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_live_unflatten(const void *fdt, struct fdt_live_tree *tree,
+		       void *buf, int bufsize);
+
+/**
+ * fdt_live_subnode - find a subnode of a given node
+ * @parent: node to search the subnodes of
+ * @name: name of the subnode to locate
+ *
+ * As with fdt_subnode_offset(), a name without a unit address matches
+ * a subnode with any unit address.
+ *
+ * returns:
+ *	the subnode, or NULL if there is none
+ */
+struct fdt_live_node *fdt_live_subnode(const struct fdt_live_node *parent,
+				       const char *name);
+
+/**
+ * fdt_live_path - find a node by its full path
+ * @tree: live tree
+ * @path: full path of the node to locate
+ *
+ * returns:
+ *	the node, or NULL if the path doesn't exist or isn't absolute
+ */
+struct fdt_live_node *fdt_live_path(const struct fdt_live_tree *tree,
+				    const char *path);
+
+/**
+ * fdt_live_next_node - step through the nodes of a live tree
+ * @node: current node
+ *
+ * returns:
+ *	the next node in depth first order, NULL after the last node
+ */
+struct fdt_live_node *fdt_live_next_node(const struct fdt_live_node *node);
+
+/**
+ * fdt_live_getprop - retrieve the value of a property of a node
+ * @node: node to get the property of
+ * @name: name of the property
+ * @lenp: pointer to an integer variable (will be overwritten) or NULL
+ *
+ * returns:
+ *	pointer to the property's value, and its length in *lenp
+ *	NULL, if the property doesn't exist, -FDT_ERR_NOTFOUND in *lenp
+ */
+const void *fdt_live_getprop(const struct fdt_live_node *node,
+			     const char *name, int *lenp);
+
+/**
+ * fdt_live_address_cells - retrieve the #address-cells of a node
+ * @node: node, the parent of the nodes with reg
+ *
+ * returns:
+ *	as fdt_address_cells_val()
+ */
+int fdt_live_address_cells(const struct fdt_live_node *node);
+
+/**
+ * fdt_live_size_cells - retrieve the #size-cells of a node
+ * @node: node, the parent of the nodes with reg
+ *
+ * returns:
+ *	as fdt_size_cells_val()
+ */
+int fdt_live_size_cells(const struct fdt_live_node *node);
+
+/**
+ * fdt_live_setprop_placeholder - allocate space for a property value
+ * @tree: live tree
+ * @node: node to set the property of
+ * @name: name of the property
+ * @len: length of the value
+ * @valp: returns the space for the value, to be filled in by the caller
+ *
+ * Creates the property if it doesn't exist, the new value replaces any
+ * old one.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, the arena is full
+ */
+int fdt_live_setprop_placeholder(struct fdt_live_tree *tree,
+				 struct fdt_live_node *node, const char *name,
+				 int len, void **valp);
+
+/**
+ * fdt_live_setprop - create or change a property
+ * @tree: live tree
+ * @node: node to set the property of
+ * @name: name of the property
+ * @val: value of the property, copied into the arena
+ * @len: length of the value
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, the arena is full
+ */
+int fdt_live_setprop(struct fdt_live_tree *tree, struct fdt_live_node *node,
+		     const char *name, const void *val, int len);
+
+static inline int fdt_live_setprop_u32(struct fdt_live_tree *tree,
+				       struct fdt_live_node *node,
+				       const char *name, uint32_t val)
+{
+	fdt32_t tmp = cpu_to_fdt32(val);
+	return fdt_live_setprop(tree, node, name, &tmp, sizeof(tmp));
+}
+
+#define fdt_live_setprop_string(tree, node, name, str) \
+	fdt_live_setprop((tree), (node), (name), (str), strlen(str)+1)
+
+/**
+ * fdt_live_delprop - delete a property
+ * @node: node to delete the property of
+ * @name: name of the property
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOTFOUND, the node has no such property
+ */
+int fdt_live_delprop(struct fdt_live_node *node, const char *name);
+
+/**
+ * fdt_live_add_subnode - create a new node
+ * @tree: live tree
+ * @parent: node to add the subnode to
+ * @name: name of the subnode
+ * @childp: returns the new node, may be NULL
+ *
+ * The new node goes before any existing subnodes, as with
+ * fdt_add_subnode().
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_EXISTS, the parent already has a subnode with this name
+ *	-FDT_ERR_NOSPACE, the arena is full
+ */
+int fdt_live_add_subnode(struct fdt_live_tree *tree,
+			 struct fdt_live_node *parent, const char *name,
+			 struct fdt_live_node **childp);
+
+/**
+ * fdt_live_del_node - delete a node and its subnodes
+ * @node: node to delete
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_BADOFFSET, node is the root node
+ */
+int fdt_live_del_node(struct fdt_live_node *node);
+
+/**
+ * fdt_live_add_mem_rsv - add a memory reservation
+ * @tree: live tree
+ * @address: start of the reserved range
+ * @size: size of the reserved range
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, the arena is full
+ */
+int fdt_live_add_mem_rsv(struct fdt_live_tree *tree, uint64_t address,
+			 uint64_t size);
+
+/**
+ * fdt_live_overlay_apply - merge a device tree overlay into a live tree
+ * @tree: live tree to apply the overlay to
+ * @fdto: pointer to the device tree overlay blob
+ *
+ * fdt_live_overlay_apply() unflattens the overlay into the arena of the
+ * tree. In a single pass, and without changing the overlay blob, it then:
+ * - indexes the phandles of the tree
+ * - renumbers the phandles of the overlay above those of the tree
+ * - applies __local_fixups__ and resolves __fixups__ through
+ *   /__symbols__
+ * - merges the __overlay__ node of each fragment into its "target" or
+ *   "target-path" node of the tree
+ * - adds the labels of the overlay to /__symbols__
+ *
+ * The overlay blob must stay unchanged until the tree has been
+ * flattened. Fragment targets are looked up among the nodes of the tree
+ * before the overlay is applied. If an error is returned the tree may
+ * have been partially changed.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, the arena is full
+ *	-FDT_ERR_NOTFOUND, a label of __fixups__ has no node with a phandle
+ *	-FDT_ERR_BADPHANDLE, a phandle of the overlay or a fragment target
+ *		is invalid
+ *	-FDT_ERR_NOPHANDLES, the renumbered phandles would overflow
+ *	-FDT_ERR_BADOVERLAY, a fixup, fragment or label can't be applied
+ *	-FDT_ERR_BADMAGIC,
+ *	-FDT_ERR_BADVERSION,
+ *	-FDT_ERR_BADSTATE,
+ *	-FDT_ERR_BADSTRUCTURE,
+ *	-FDT_ERR_TRUNCATED, standard meanings
+ */
+int fdt_live_overlay_apply(struct fdt_live_tree *tree, const void *fdto);
+
+/**
+ * fdt_live_flatten - write a live tree as a packed device tree blob
+ * @tree: live tree
+ * @buf: 4 byte aligned memory for the blob, must not overlap the blob
+ *	the tree was unflattened from
+ * @bufsize: size of buf
+ *
+ * The blob gets a version 17 header, a structure block without NOPs
+ * and a strings block with each property name once. Its totalsize is
+ * exactly what it takes.
+ *
+ * returns:
+ *	0, on success
+ *	-FDT_ERR_NOSPACE, buf is too small for the blob
+ */
+int fdt_live_flatten(struct fdt_live_tree *tree, void *buf, int bufsize);
+
+/**********************************************************************/
+/* Hashing                                                            */
+/**********************************************************************/
+
+/**
+ * fdt_fnv1a - 32-bit FNV-1a hash of a name
+ * @s: characters to hash, not necessarily NUL terminated
+ * @len: number of characters
+ *
+ * The hash the live tree uses for property names, for callers that
+ * hash names or compatible strings found in a tree themselves.
+ *
+ * returns:
+ *	the hash of the len characters at s
+ */
+static inline uint32_t fdt_fnv1a(const char *s, int len)
+{
+	uint32_t h = 2166136261U;
+	int i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ (uint8_t)s[i]) * 16777619U;
+	return h;
+}
+
 /**********************************************************************/
 /* Debugging / informational functions                                */
 /**********************************************************************/
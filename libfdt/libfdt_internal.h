@@ -66,6 +66,33 @@ int _fdt_check_node_offset(const void *fdt, int offset);
 int _fdt_check_prop_offset(const void *fdt, int offset);
 const char *_fdt_find_string(const char *strtab, int tabsize, const char *s);
 int _fdt_node_end_offset(void *fdt, int nodeoffset);
+void _fdt_getprops_init(int num, const void **vals, int *lens);
+int _fdt_getprops_match(const char *name, const void *val, int len,
+			const char *const *names, int num,
+			const void **vals, int *lens);
+
+uint32_t _fdt_index_name_hash(const char *name, int len);
+struct fdt_index *_fdt_index_get(const void *fdt, struct fdt_index *idx);
+struct fdt_index_entry *_fdt_index_find(struct fdt_index *idx, int offset);
+void _fdt_index_splice(struct fdt_index *idx, int offset, int oldlen,
+		       int newlen);
+void _fdt_index_add(struct fdt_index *idx, int parentoffset, int offset,
+		    const char *name, int namelen);
+void _fdt_index_remove(struct fdt_index *idx, int nodeoffset);
+void _fdt_index_rename(struct fdt_index *idx, int nodeoffset,
+		       const char *name, int namelen);
+
+void *_fdt_live_alloc(struct fdt_live_tree *tree, int len);
+struct fdt_live_name *_fdt_live_name(struct fdt_live_tree *tree,
+				     const char *str, int copy);
+int _fdt_live_unflatten_nodes(struct fdt_live_tree *tree, const void *fdt,
+			      struct fdt_live_node **rootp);
+struct fdt_live_node *_fdt_live_subnode_namelen(
+	const struct fdt_live_node *parent, const char *name, int namelen);
+struct fdt_live_node *_fdt_live_path_namelen(struct fdt_live_node *root,
+					    const char *path, int len);
+struct fdt_live_prop *_fdt_live_get_property(
+	const struct fdt_live_node *node, const char *name);
 
 static inline const void *_fdt_offset_ptr(const void *fdt, int offset)
 {
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef INTERVAL_SET_H
+#define INTERVAL_SET_H
+
+#include <types_ext.h>
+
+/* The half-open range [start, end) */
+struct interval {
+	uint64_t start;
+	uint64_t end;
+};
+
+/*
+ * A set of ranges kept in an array supplied by the caller. Once
+ * coalesced the intervals are sorted, non-empty, and neither overlap nor
+ * touch, which is what all functions but interval_set_add() require and
+ * keep.
+ */
+struct interval_set {
+	struct interval *ivs;
+	size_t num;
+	size_t max;
+};
+
+void interval_set_init(struct interval_set *set, struct interval *ivs,
+		       size_t max);
+
+/*
+ * Appends [start, end) in any order, to be followed by
+ * interval_set_coalesce() once all ranges are added. Empty ranges are
+ * ignored. Returns false if the set is full.
+ */
+bool interval_set_add(struct interval_set *set, uint64_t start, uint64_t end);
+
+/* Sorts the set and merges overlapping and adjacent ranges, O(n log n) */
+void interval_set_coalesce(struct interval_set *set);
+
+/*
+ * Adds [start, end) to a coalesced set, merging it with the ranges it
+ * overlaps or touches. Returns false if the set is full.
+ */
+bool interval_set_insert(struct interval_set *set, uint64_t start,
+			 uint64_t end);
+
+/*
+ * Removes [start, end) from a coalesced set, which splits a range in two
+ * if [start, end) is strictly inside it. Returns false if the set is full.
+ */
+bool interval_set_subtract(struct interval_set *set, uint64_t start,
+			   uint64_t end);
+
+/*
+ * Sets dst to a minus b in one merge of the two coalesced sets, dst needs
+ * room for a->num + b->num ranges at most. Returns false if dst is full.
+ */
+bool interval_set_difference(struct interval_set *dst,
+			     const struct interval_set *a,
+			     const struct interval_set *b);
+
+/* Returns the range of a coalesced set containing addr, or NULL */
+const struct interval *interval_set_find(const struct interval_set *set,
+					 uint64_t addr);
+
+/* True if [start, end) is inside a single range of a coalesced set */
+bool interval_set_covers(const struct interval_set *set, uint64_t start,
+			 uint64_t end);
+
+#endif /*INTERVAL_SET_H*/
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef LZ4_H
+#define LZ4_H
+
+#include <types_ext.h>
+
+/*
+ * Streaming decompression of the LZ4 frame format.
+ *
+ * The whole compressed frame is expected to be accessible in memory while
+ * output is produced in pieces by lz4_stream_read(), each piece can be
+ * placed anywhere. Matches reaching back past the start of the current
+ * piece are resolved from the previous pieces, which must be left
+ * untouched until the frame has been decompressed.
+ *
+ * Block and content checksums are skipped, not verified.
+ */
+
+#define LZ4_FRAME_MAGIC		0x184D2204
+
+/* Number of earlier output pieces remembered for back references */
+#define LZ4_HIST_SEGMENTS	4
+
+struct lz4_segment {
+	uint8_t *start;
+	size_t len;
+};
+
+struct lz4_stream {
+	const uint8_t *in;
+	const uint8_t *in_end;
+	const uint8_t *block_end;
+	const uint8_t *lit_src;
+	size_t lit_len;
+	size_t match_len;
+	size_t match_offs;
+	uint64_t content_size;
+	uint8_t flags;
+	bool in_block;
+	bool done;
+	struct lz4_segment hist[LZ4_HIST_SEGMENTS];
+};
+
+/* Returns true if buf starts with an LZ4 frame */
+bool lz4_is_frame(const void *buf, size_t len);
+
+/* Parses the frame header, returns 0 on success or -1 on bad input */
+int lz4_stream_init(struct lz4_stream *s, const void *src, size_t len);
+
+/* Decompressed size stored in the frame header or 0 if not present */
+uint64_t lz4_stream_content_size(const struct lz4_stream *s);
+
+/*
+ * Decompresses up to len bytes into dst. Returns the number of bytes
+ * produced, less than len only at the end of the frame, or -1 if the
+ * input is corrupt.
+ */
+ssize_t lz4_stream_read(struct lz4_stream *s, void *dst, size_t len);
+
+#endif /*LZ4_H*/
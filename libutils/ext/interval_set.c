@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <interval_set.h>
+#include <stdlib.h>
+#include <string.h>
+
+void interval_set_init(struct interval_set *set, struct interval *ivs,
+		       size_t max)
+{
+	set->ivs = ivs;
+	set->num = 0;
+	set->max = max;
+}
+
+bool interval_set_add(struct interval_set *set, uint64_t start, uint64_t end)
+{
+	if (start >= end)
+		return true;
+	if (set->num >= set->max)
+		return false;
+
+	set->ivs[set->num].start = start;
+	set->ivs[set->num].end = end;
+	set->num++;
+	return true;
+}
+
+static int cmp_start(const void *a, const void *b)
+{
+	const struct interval *ia = a;
+	const struct interval *ib = b;
+
+	if (ia->start < ib->start)
+		return -1;
+	return ia->start > ib->start;
+}
+
+void interval_set_coalesce(struct interval_set *set)
+{
+	size_t n;
+	size_t num = 0;
+
+	if (!set->num)
+		return;
+
+	qsort(set->ivs, set->num, sizeof(*set->ivs), cmp_start);
+
+	for (n = 1; n < set->num; n++) {
+		if (set->ivs[n].start <= set->ivs[num].end) {
+			if (set->ivs[n].end > set->ivs[num].end)
+				set->ivs[num].end = set->ivs[n].end;
+		} else {
+			set->ivs[++num] = set->ivs[n];
+		}
+	}
+	set->num = num + 1;
+}
+
+/* Index of the first range ending at or after addr, or set->num */
+static size_t lower_bound(const struct interval_set *set, uint64_t addr)
+{
+	size_t lo = 0;
+	size_t hi = set->num;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (set->ivs[mid].end < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+bool interval_set_insert(struct interval_set *set, uint64_t start,
+			 uint64_t end)
+{
+	size_t first;
+	size_t last;
+
+	if (start >= end)
+		return true;
+
+	/* Ranges [first, last) overlap or touch [start, end) */
+	first = lower_bound(set, start);
+	for (last = first; last < set->num && set->ivs[last].start <= end;
+	     last++)
+		;
+
+	if (first == last) {
+		if (set->num >= set->max)
+			return false;
+		memmove(set->ivs + first + 1, set->ivs + first,
+			(set->num - first) * sizeof(*set->ivs));
+		set->ivs[first].start = start;
+		set->ivs[first].end = end;
+		set->num++;
+		return true;
+	}
+
+	if (set->ivs[first].start < start)
+		start = set->ivs[first].start;
+	if (set->ivs[last - 1].end > end)
+		end = set->ivs[last - 1].end;
+	set->ivs[first].start = start;
+	set->ivs[first].end = end;
+	memmove(set->ivs + first + 1, set->ivs + last,
+		(set->num - last) * sizeof(*set->ivs));
+	set->num -= last - first - 1;
+	return true;
+}
+
+bool interval_set_subtract(struct interval_set *set, uint64_t start,
+			   uint64_t end)
+{
+	struct interval *iv;
+	size_t first;
+	size_t last;
+
+	if (start >= end)
+		return true;
+
+	/* Ranges [first, last) overlap [start, end) */
+	first = lower_bound(set, start);
+	if (first < set->num && set->ivs[first].end == start)
+		first++;
+	for (last = first; last < set->num && set->ivs[last].start < end;
+	     last++)
+		;
+	if (first == last)
+		return true;
+
+	iv = set->ivs + first;
+	if (last - first == 1 && iv->start < start && iv->end > end) {
+		if (set->num >= set->max)
+			return false;
+		memmove(iv + 1, iv, (set->num - first) * sizeof(*iv));
+		iv[0].end = start;
+		iv[1].start = end;
+		set->num++;
+		return true;
+	}
+
+	/* Keep the parts sticking out on either side */
+	if (iv->start < start) {
+		iv->end = start;
+		first++;
+	}
+	if (set->ivs[last - 1].end > end) {
+		set->ivs[last - 1].start = end;
+		last--;
+	}
+	memmove(set->ivs + first, set->ivs + last,
+		(set->num - last) * sizeof(*set->ivs));
+	set->num -= last - first;
+	return true;
+}
+
+bool interval_set_difference(struct interval_set *dst,
+			     const struct interval_set *a,
+			     const struct interval_set *b)
+{
+	size_t nb = 0;
+	size_t na;
+
+	dst->num = 0;
+	for (na = 0; na < a->num; na++) {
+		uint64_t start = a->ivs[na].start;
+		uint64_t end = a->ivs[na].end;
+
+		/* Ranges of b entirely before this one don't matter */
+		while (nb < b->num && b->ivs[nb].end <= start)
+			nb++;
+
+		while (nb < b->num && b->ivs[nb].start < end) {
+			if (!interval_set_add(dst, start, b->ivs[nb].start))
+				return false;
+			if (b->ivs[nb].end >= end) {
+				start = end;
+				break;
+			}
+			start = b->ivs[nb].end;
+			nb++;
+		}
+		if (!interval_set_add(dst, start, end))
+			return false;
+	}
+	return true;
+}
+
+const struct interval *interval_set_find(const struct interval_set *set,
+					 uint64_t addr)
+{
+	size_t n = lower_bound(set, addr);
+
+	/* A range ending at addr doesn't contain it, the next one may */
+	if (n < set->num && set->ivs[n].end == addr)
+		n++;
+	if (n < set->num && set->ivs[n].start <= addr)
+		return set->ivs + n;
+	return NULL;
+}
+
+bool interval_set_covers(const struct interval_set *set, uint64_t start,
+			 uint64_t end)
+{
+	const struct interval *iv;
+
+	if (start >= end)
+		return true;
+
+	iv = interval_set_find(set, start);
+	return iv && iv->end >= end;
+}
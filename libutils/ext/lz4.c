@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <lz4.h>
+#include <string.h>
+
+#define FLG_VERSION_MASK	0xc0
+#define FLG_VERSION		0x40
+#define FLG_BLOCK_CHECKSUM	(1 << 4)
+#define FLG_CONTENT_SIZE	(1 << 3)
+#define FLG_CONTENT_CHECKSUM	(1 << 2)
+#define FLG_RESERVED		(1 << 1)
+#define FLG_DICT_ID		(1 << 0)
+
+#define BLOCK_UNCOMPRESSED	(1U << 31)
+
+#define MIN_MATCH		4
+#define MAX_OFFSET		0xffff
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool lz4_is_frame(const void *buf, size_t len)
+{
+	return len >= 4 && get_le32(buf) == LZ4_FRAME_MAGIC;
+}
+
+int lz4_stream_init(struct lz4_stream *s, const void *src, size_t len)
+{
+	const uint8_t *p = src;
+	size_t hdr_len = 4 + 3;
+
+	memset(s, 0, sizeof(*s));
+
+	if (!lz4_is_frame(src, len) || len < hdr_len)
+		return -1;
+
+	s->flags = p[4];
+	if ((s->flags & FLG_VERSION_MASK) != FLG_VERSION ||
+	    (s->flags & FLG_RESERVED))
+		return -1;
+
+	if (s->flags & FLG_CONTENT_SIZE)
+		hdr_len += 8;
+	if (s->flags & FLG_DICT_ID)
+		hdr_len += 4;
+	if (len < hdr_len)
+		return -1;
+
+	if (s->flags & FLG_CONTENT_SIZE)
+		s->content_size = get_le32(p + 6) |
+				  ((uint64_t)get_le32(p + 10) << 32);
+
+	/* Header checksum is last and not verified */
+	s->in = p + hdr_len;
+	s->in_end = p + len;
+	s->block_end = s->in;
+	return 0;
+}
+
+uint64_t lz4_stream_content_size(const struct lz4_stream *s)
+{
+	return s->content_size;
+}
+
+/* Reads a length continued in extra bytes as long as they are 255 */
+static int get_ext_len(struct lz4_stream *s, size_t *len)
+{
+	uint8_t b;
+
+	do {
+		if (s->in >= s->block_end)
+			return -1;
+		b = *s->in++;
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+/* Starts the next block, returns 1 at the end of the frame */
+static int next_block(struct lz4_stream *s)
+{
+	uint32_t bsize;
+
+	if (s->block_end != s->in)
+		return -1;
+	if (s->in_block && (s->flags & FLG_BLOCK_CHECKSUM)) {
+		if (s->in_end - s->in < 4)
+			return -1;
+		s->in += 4;
+	}
+
+	if (s->in_end - s->in < 4)
+		return -1;
+	bsize = get_le32(s->in);
+	s->in += 4;
+
+	if (!bsize) {
+		s->done = true;
+		return 1;
+	}
+
+	if ((size_t)(s->in_end - s->in) < (bsize & ~BLOCK_UNCOMPRESSED))
+		return -1;
+	s->block_end = s->in + (bsize & ~BLOCK_UNCOMPRESSED);
+	s->in_block = true;
+
+	/* An uncompressed block is one long run of literals */
+	if (bsize & BLOCK_UNCOMPRESSED) {
+		s->lit_src = s->in;
+		s->lit_len = bsize & ~BLOCK_UNCOMPRESSED;
+		s->in = s->block_end;
+	}
+
+	return 0;
+}
+
+/* Parses the next sequence of literals and match in the current block */
+static int next_sequence(struct lz4_stream *s)
+{
+	uint8_t token = *s->in++;
+	size_t lit_len = token >> 4;
+	size_t match_len = token & 0xf;
+
+	if (lit_len == 0xf && get_ext_len(s, &lit_len))
+		return -1;
+	if ((size_t)(s->block_end - s->in) < lit_len)
+		return -1;
+	s->lit_src = s->in;
+	s->lit_len = lit_len;
+	s->in += lit_len;
+
+	/* The last sequence of a block has no match */
+	if (s->in == s->block_end)
+		return 0;
+
+	if (s->block_end - s->in < 2)
+		return -1;
+	s->match_offs = s->in[0] | (s->in[1] << 8);
+	s->in += 2;
+	if (!s->match_offs)
+		return -1;
+
+	if (match_len == 0xf && get_ext_len(s, &match_len))
+		return -1;
+	s->match_len = match_len + MIN_MATCH;
+
+	return 0;
+}
+
+/* Adds dst to the output history, unless it continues the last piece */
+static void hist_add(struct lz4_stream *s, uint8_t *dst)
+{
+	struct lz4_segment *cur = s->hist + LZ4_HIST_SEGMENTS - 1;
+
+	if (cur->start && cur->start + cur->len == dst)
+		return;
+
+	memmove(s->hist, s->hist + 1, sizeof(s->hist) - sizeof(s->hist[0]));
+	cur->start = dst;
+	cur->len = 0;
+}
+
+/* Finds the output byte offs bytes back from the end of the history */
+static const uint8_t *hist_byte(struct lz4_stream *s, size_t offs)
+{
+	int n;
+
+	for (n = LZ4_HIST_SEGMENTS - 1; n >= 0; n--) {
+		if (offs <= s->hist[n].len)
+			return s->hist[n].start + s->hist[n].len - offs;
+		offs -= s->hist[n].len;
+	}
+
+	return NULL;
+}
+
+static int copy_match(struct lz4_stream *s, uint8_t *out, size_t n)
+{
+	struct lz4_segment *cur = s->hist + LZ4_HIST_SEGMENTS - 1;
+	const uint8_t *src;
+	size_t l;
+
+	if (s->match_offs <= cur->len) {
+		/* The common case, the match is in the current piece */
+		src = out - s->match_offs;
+		if (s->match_offs >= n) {
+			memcpy(out, src, n);
+		} else {
+			for (l = 0; l < n; l++)
+				out[l] = src[l];
+		}
+		return 0;
+	}
+
+	for (l = 0; l < n; l++) {
+		src = hist_byte(s, s->match_offs);
+		if (!src)
+			return -1;
+		out[l] = *src;
+		cur->len++;
+	}
+	cur->len -= n;
+
+	return 0;
+}
+
+ssize_t lz4_stream_read(struct lz4_stream *s, void *dst, size_t len)
+{
+	struct lz4_segment *cur = s->hist + LZ4_HIST_SEGMENTS - 1;
+	uint8_t *out = dst;
+	uint8_t *out_end = out + len;
+	size_t n;
+	int r;
+
+	hist_add(s, out);
+
+	while (out < out_end) {
+		if (s->lit_len) {
+			n = s->lit_len;
+			if (n > (size_t)(out_end - out))
+				n = out_end - out;
+			memcpy(out, s->lit_src, n);
+			s->lit_src += n;
+			s->lit_len -= n;
+		} else if (s->match_len) {
+			n = s->match_len;
+			if (n > (size_t)(out_end - out))
+				n = out_end - out;
+			if (copy_match(s, out, n))
+				return -1;
+			s->match_len -= n;
+		} else if (s->done) {
+			break;
+		} else if (s->in == s->block_end) {
+			r = next_block(s);
+			if (r < 0)
+				return -1;
+			continue;
+		} else {
+			if (next_sequence(s))
+				return -1;
+			continue;
+		}
+
+		out += n;
+		cur->len += n;
+	}
+
+	return out - (uint8_t *)dst;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2014, Linaro Limited
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sha256.h>
+#include <string.h>
+
+static const uint32_t k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+#define S0(x)		(ROR(x, 2) ^ ROR(x, 13) ^ ROR(x, 22))
+#define S1(x)		(ROR(x, 6) ^ ROR(x, 11) ^ ROR(x, 25))
+#define s0(x)		(ROR(x, 7) ^ ROR(x, 18) ^ ((x) >> 3))
+#define s1(x)		(ROR(x, 17) ^ ROR(x, 19) ^ ((x) >> 10))
+#define CH(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)	(((x) & (y)) | ((z) & ((x) | (y))))
+
+/* Message schedule kept in a rolling window of 16 words */
+#define W(i)		w[(i) & 15]
+#define SCHED(i)	(W(i) += s1(W((i) - 2)) + W((i) - 7) + s0(W((i) - 15)))
+
+/*
+ * One round with the working variables passed rotated instead of moved
+ * around, eight consecutive rounds bring them back in place.
+ */
+#define ROUND(a, b, c, d, e, f, g, h, i, wi) \
+	do { \
+		uint32_t t = (h) + S1(e) + CH(e, f, g) + k[i] + (wi); \
+		(d) += t; \
+		(h) = t + S0(a) + MAJ(a, b, c); \
+	} while (0)
+
+#define ROUND8(i, wi) \
+	do { \
+		ROUND(a, b, c, d, e, f, g, h, (i) + 0, wi((i) + 0)); \
+		ROUND(h, a, b, c, d, e, f, g, (i) + 1, wi((i) + 1)); \
+		ROUND(g, h, a, b, c, d, e, f, (i) + 2, wi((i) + 2)); \
+		ROUND(f, g, h, a, b, c, d, e, (i) + 3, wi((i) + 3)); \
+		ROUND(e, f, g, h, a, b, c, d, (i) + 4, wi((i) + 4)); \
+		ROUND(d, e, f, g, h, a, b, c, (i) + 5, wi((i) + 5)); \
+		ROUND(c, d, e, f, g, h, a, b, (i) + 6, wi((i) + 6)); \
+		ROUND(b, c, d, e, f, g, h, a, (i) + 7, wi((i) + 7)); \
+	} while (0)
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void transform(uint32_t state[8], const uint8_t *data, size_t nblocks)
+{
+	uint32_t w[16];
+	uint32_t a, b, c, d, e, f, g, h;
+	size_t i;
+
+	while (nblocks--) {
+		for (i = 0; i < 16; i++)
+			w[i] = get_be32(data + i * 4);
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		ROUND8(0, W);
+		ROUND8(8, W);
+		for (i = 16; i < 64; i += 8)
+			ROUND8(i, SCHED);
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
+
+		data += SHA256_BLOCK_SIZE;
+	}
+}
+
+void sha256_init(struct sha256_ctx *ctx)
+{
+	static const uint32_t iv[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	memcpy(ctx->state, iv, sizeof(iv));
+	ctx->len = 0;
+	ctx->buf_len = 0;
+}
+
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	size_t n;
+
+	ctx->len += len;
+
+	if (ctx->buf_len) {
+		n = SHA256_BLOCK_SIZE - ctx->buf_len;
+		if (n > len)
+			n = len;
+		memcpy(ctx->buf + ctx->buf_len, p, n);
+		ctx->buf_len += n;
+		p += n;
+		len -= n;
+		if (ctx->buf_len < SHA256_BLOCK_SIZE)
+			return;
+		transform(ctx->state, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+
+	n = len / SHA256_BLOCK_SIZE;
+	if (n) {
+		transform(ctx->state, p, n);
+		p += n * SHA256_BLOCK_SIZE;
+		len -= n * SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(ctx->buf, p, len);
+	ctx->buf_len = len;
+}
+
+void sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_SIZE])
+{
+	uint64_t bits = ctx->len * 8;
+	size_t i;
+
+	ctx->buf[ctx->buf_len++] = 0x80;
+	if (ctx->buf_len > SHA256_BLOCK_SIZE - 8) {
+		memset(ctx->buf + ctx->buf_len, 0,
+		       SHA256_BLOCK_SIZE - ctx->buf_len);
+		transform(ctx->state, ctx->buf, 1);
+		ctx->buf_len = 0;
+	}
+	memset(ctx->buf + ctx->buf_len, 0,
+	       SHA256_BLOCK_SIZE - 8 - ctx->buf_len);
+	put_be32(ctx->buf + SHA256_BLOCK_SIZE - 8, bits >> 32);
+	put_be32(ctx->buf + SHA256_BLOCK_SIZE - 4, bits);
+	transform(ctx->state, ctx->buf, 1);
+
+	for (i = 0; i < 8; i++)
+		put_be32(digest + i * 4, ctx->state[i]);
+}
+
+void sha256_copy(struct sha256_ctx *ctx, void *dst, const void *src,
+		 size_t len)
+{
+	uint8_t *d = dst;
+	const uint8_t *s = src;
+	size_t n;
+
+	while (len) {
+		n = len;
+		if (n > SHA256_COPY_CHUNK_SIZE)
+			n = SHA256_COPY_CHUNK_SIZE;
+
+		/* Hash the copy while it's still in the cache */
+		memcpy(d, s, n);
+		sha256_update(ctx, d, n);
+
+		d += n;
+		s += n;
+		len -= n;
+	}
+}
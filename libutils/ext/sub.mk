@@ -3,3 +3,6 @@ global-incdirs-y += include
 srcs-y += strlcat.c
 srcs-y += strlcpy.c
 srcs-y += buf_compare_ct.c
+srcs-y += lz4.c
+srcs-y += sha256.c
+srcs-y += interval_set.c
@@ -2,3 +2,4 @@ srcs-y += aeabi_divmod_asm.S
 srcs-y += aeabi_divmod.c
 srcs-y += aeabi_ldivmod_asm.S
 srcs-y += aeabi_ldivmod.c
+srcs-$(libutil_with_arm32_memcpy) += memcpy.S
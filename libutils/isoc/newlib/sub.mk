@@ -5,8 +5,10 @@ cflags-memchr.c-y += -Wno-sign-compare
 srcs-y += memcmp.c
 cflags-remove-memcmp.c-y += -Wcast-align
 
+ifneq ($(libutil_with_arm32_memcpy),y)
 srcs-y += memcpy.c
 cflags-remove-memcpy.c-y += -Wcast-align
+endif
 
 srcs-y += memmove.c
 cflags-remove-memmove.c-y += -Wcast-align